@@ -2,6 +2,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/inotify.h>
 #include "assembler.h"
 
 // Instruction opcode definitions
@@ -21,27 +26,87 @@ enum Opcode {
     OR   = 0b0011,    // 0011 Bitwise OR operation
     XOR  = 0b1011,    // 1011 Bitwise XOR operation
     SHL  = 0b0111,    // 0111 Shift left operation
-    SHR  = 0b1111     // 1111 Shift right operation
+    SHR  = 0b1111,    // 1111 Shift right operation
+    TAS  = 0b10000,   // 0000 + bit 18: atomic test-and-set (extension)
+    LDX  = 0b10001    // 0001 + bit 18: load the index register (extension)
+};
+
+// Addressing modes, selected by operand syntax
+enum AddressingMode {
+    MODE_DIRECT    = 0,   // x      operand is the address
+    MODE_INDIRECT  = 1,   // @x     word x holds the address
+    MODE_IMMEDIATE = 2,   // #n     operand is the value itself
+    MODE_RELATIVE  = 3    // *+n    address is the instruction's own plus n (*-n backwards)
 };
 
 // Display program usage information
 void printUsage(const char *programName) {
-    printf("Usage: %s <input file> <output file> [-q]\n", programName);
+    printf("Usage: %s <input file> <output file> [-q] [--log LEVEL] [-c | --watch]\n", programName);
+    printf("Use - as the input or output file to read stdin or write stdout.\n");
     printf("Options:\n");
-    printf("  -q    Quiet mode (no verbose output)\n");
+    printf("  -q       Quiet mode (no verbose output, same as --log summary)\n");
+    printf("  --log LEVEL  Messages: off, summary or instruction (default instruction)\n");
+    printf("  -c       Emit a relocatable object for baby-ld instead of machine code\n");
+    printf("  --watch  Keep running and reassemble incrementally when the input changes\n");
 }
 
+// Descriptor machine code goes to when the output file is "-"
+static int codeOutputFd = STDOUT_FILENO;
+
 // Initialize assembler state
 void initAssembler(AssemblerState *state, const char *inputFile, const char *outputFile) {
     state->symbolTable.count = 0;
     state->inputFileName = strdup(inputFile);
     state->outputFileName = strdup(outputFile);
-    state->verbose = true;
+    state->logLevel = LOG_INSTRUCTION;
+    state->source = NULL;
+    state->sourceLength = 0;
+}
+
+// Open the input for one pass; "-" reads stdin once and replays it from memory
+FILE *openSource(AssemblerState *state) {
+    if (strcmp(state->inputFileName, "-") != 0) {
+        return fopen(state->inputFileName, "r");
+    }
+
+    if (!state->source) {
+        size_t capacity = 4096;
+        size_t n;
+        state->source = malloc(capacity);
+        while ((n = fread(state->source + state->sourceLength, 1,
+                          capacity - state->sourceLength, stdin)) > 0) {
+            state->sourceLength += n;
+            if (state->sourceLength == capacity) {
+                capacity *= 2;
+                state->source = realloc(state->source, capacity);
+            }
+        }
+    }
+    if (state->sourceLength == 0) {
+        return fopen("/dev/null", "r");
+    }
+    return fmemopen(state->source, state->sourceLength, "r");
+}
+
+// Open the output; "-" writes machine code to the original stdout
+FILE *openOutput(const char *outputFile) {
+    if (strcmp(outputFile, "-") == 0) {
+        return fdopen(dup(codeOutputFd), "w");
+    }
+    return fopen(outputFile, "w");
+}
+
+// Keep stdout clean for machine code: all messages go to stderr instead
+void redirectMessagesToStderr(void) {
+    fflush(stdout);
+    codeOutputFd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
 }
 
 // Add symbol to symbol table
 int addSymbol(SymbolTable *table, const char *name, int address) {
     if (table->count >= MAX_SYMBOLS) {
+        LOG_FLUSH();
         printf("Error: Symbol table is full\n");
         return -1;
     }
@@ -49,6 +114,7 @@ int addSymbol(SymbolTable *table, const char *name, int address) {
     // Check if symbol already exists
     for (int i = 0; i < table->count; i++) {
         if (strcmp(table->symbols[i].name, name) == 0) {
+            LOG_FLUSH();
             printf("Error: Symbol '%s' already defined\n", name);
             return -1;
         }
@@ -70,17 +136,14 @@ int findSymbol(SymbolTable *table, const char *name) {
     return -1;
 }
 
-// Parse instruction and convert to machine code
-uint32_t parseInstruction(char* line, SymbolTable* table) {
+// Split a source line into opcode and operand (label and comment are dropped)
+bool tokenizeLine(char *line, char **opcode, char **operand) {
     char* token;
-    char* opcode;
-    char* operand;
-    uint32_t instruction = 0;
 
     // Skip whitespace and handle comments
     while (isspace(*line)) line++;
     if (*line == ';' || *line == '\0') {
-        return 0;
+        return false;
     }
     
     // Handle labels
@@ -94,15 +157,122 @@ uint32_t parseInstruction(char* line, SymbolTable* table) {
     }
     
     // Get opcode
-    opcode = strtok(token, " \t\n");
-    if (!opcode) return 0;
+    *opcode = strtok(token, " \t\n");
+    if (!*opcode) return false;
     
     // Get operand
-    operand = strtok(NULL, ";");
-    if (operand) {
-        while (isspace(*operand)) operand++;
-        char *end = operand + strlen(operand) - 1;
-        while (end > operand && isspace(*end)) *end-- = '\0';
+    *operand = strtok(NULL, ";");
+    if (*operand) {
+        while (isspace(**operand)) (*operand)++;
+        char *end = *operand + strlen(*operand) - 1;
+        while (end > *operand && isspace(*end)) *end-- = '\0';
+    }
+    return true;
+}
+
+// Encode an address into the operand field (1-13 bits, leftmost is 2^0)
+uint32_t encodeAddress(int addr) {
+    uint32_t field = 0;
+    for (int i = 0; i < 13; i++) {
+        if (addr & (1 << i)) {
+            field |= (1UL << (32 - 1 - i));
+        }
+    }
+    return field;
+}
+
+// Map a mnemonic to its 4-bit opcode, -1 if unknown
+int lookupOpcode(const char *opcode) {
+    if (strcmp(opcode, "JMP") == 0) return 0b0000;
+    else if (strcmp(opcode, "JRP") == 0) return 0b1000;
+    else if (strcmp(opcode, "LDN") == 0) return 0b0100;
+    else if (strcmp(opcode, "STO") == 0) return 0b1100;
+    else if (strcmp(opcode, "SUB") == 0) return 0b0010;
+    else if (strcmp(opcode, "SUB2") == 0) return 0b1010;
+    else if (strcmp(opcode, "CMP") == 0) return 0b0110;
+    else if (strcmp(opcode, "STP") == 0) return 0b1110;
+    else if (strcmp(opcode, "ADD") == 0) return 0b0001;
+    else if (strcmp(opcode, "MUL") == 0) return 0b1001;
+    else if (strcmp(opcode, "DIV") == 0) return 0b0101;
+    else if (strcmp(opcode, "AND") == 0) return 0b1101;
+    else if (strcmp(opcode, "OR") == 0) return 0b0011;
+    else if (strcmp(opcode, "XOR") == 0) return 0b1011;
+    else if (strcmp(opcode, "SHL") == 0) return 0b0111;
+    else if (strcmp(opcode, "SHR") == 0) return 0b1111;
+    else if (strcmp(opcode, "TAS") == 0) return 0b10000;
+    else if (strcmp(opcode, "LDX") == 0) return 0b10001;
+    return -1;
+}
+
+// Encode an addressing mode into bits 19-20, and the index flag into bit 21
+uint32_t encodeMode(int mode, bool indexed) {
+    return ((uint32_t)(mode & 1) << (32 - 19)) | ((uint32_t)(mode >> 1) << (32 - 20)) |
+           ((uint32_t)indexed << (32 - 21));
+}
+
+// Split the addressing syntax off an operand in place: a leading @ (indirect),
+// # (immediate) or *+ / *- (relative), and a trailing ",X" (indexed).
+// Returns the bare address, number or symbol.
+char *splitOperand(char *operand, int *mode, bool *indexed) {
+    *mode = MODE_DIRECT;
+    *indexed = false;
+
+    char *comma = strrchr(operand, ',');
+    if (comma) {
+        char *reg = comma + 1;
+        while (isspace(*reg)) reg++;
+        if (strcmp(reg, "X") == 0) {
+            *indexed = true;
+            *comma = '\0';
+            char *end = comma - 1;
+            while (end > operand && isspace(*end)) *end-- = '\0';
+        }
+    }
+
+    if (*operand == '@') {
+        *mode = MODE_INDIRECT;
+        operand++;
+    } else if (*operand == '#') {
+        *mode = MODE_IMMEDIATE;
+        operand++;
+    } else if (operand[0] == '*' && (operand[1] == '+' || operand[1] == '-')) {
+        // Keep a minus sign: a backwards offset wraps around the 13-bit operand field
+        *mode = MODE_RELATIVE;
+        operand += operand[1] == '+' ? 2 : 1;
+    }
+    while (isspace(*operand)) operand++;
+    return operand;
+}
+
+// Whether a bare operand is a number rather than a symbol
+bool isNumericOperand(const char *operand) {
+    return isdigit(*operand) || (*operand == '-' && isdigit(operand[1]));
+}
+
+// Encode an opcode into bits 14-17, with the extension flag of opcodes above 15 in bit 18
+uint32_t encodeOpcode(int op) {
+    return ((uint32_t)(op & 0xF) << (32 - 17)) | ((uint32_t)(op >> 4) << (32 - 18));
+}
+
+// Decode the operand field of an encoded instruction back into an address
+int decodeAddress(uint32_t instruction) {
+    int addr = 0;
+    for (int i = 0; i < 13; i++) {
+        if (instruction & (1UL << (32 - 1 - i))) {
+            addr |= (1 << i);
+        }
+    }
+    return addr;
+}
+
+// Parse instruction and convert to machine code
+uint32_t parseInstruction(char* line, SymbolTable* table) {
+    char* opcode;
+    char* operand;
+    uint32_t instruction = 0;
+
+    if (!tokenizeLine(line, &opcode, &operand)) {
+        return 0;
     }
     
     // Handle VAR instruction
@@ -121,31 +291,18 @@ uint32_t parseInstruction(char* line, SymbolTable* table) {
         return 0;
     }
     
-    // Parse opcode (4 bits)
-    int op = -1;
-    if (strcmp(opcode, "JMP") == 0) op = 0b0000;
-    else if (strcmp(opcode, "JRP") == 0) op = 0b1000;
-    else if (strcmp(opcode, "LDN") == 0) op = 0b0100;
-    else if (strcmp(opcode, "STO") == 0) op = 0b1100;
-    else if (strcmp(opcode, "SUB") == 0) op = 0b0010;
-    else if (strcmp(opcode, "SUB2") == 0) op = 0b1010;
-    else if (strcmp(opcode, "CMP") == 0) op = 0b0110;
-    else if (strcmp(opcode, "STP") == 0) {
-        // STP instruction handling
+    // STP instruction handling
+    if (strcmp(opcode, "STP") == 0) {
         instruction = 0;  // Clear
         instruction |= ((uint32_t)0b1110 << (32 - 17));  // Place opcode 1110 in bits 14-17
         return instruction;
     }
-    else if (strcmp(opcode, "ADD") == 0) op = 0b0001;
-    else if (strcmp(opcode, "MUL") == 0) op = 0b1001;
-    else if (strcmp(opcode, "DIV") == 0) op = 0b0101;
-    else if (strcmp(opcode, "AND") == 0) op = 0b1101;
-    else if (strcmp(opcode, "OR") == 0) op = 0b0011;
-    else if (strcmp(opcode, "XOR") == 0) op = 0b1011;
-    else if (strcmp(opcode, "SHL") == 0) op = 0b0111;
-    else if (strcmp(opcode, "SHR") == 0) op = 0b1111;
+
+    // Parse opcode (4 bits)
+    int op = lookupOpcode(opcode);
 
     if (op == -1) {
+        LOG_FLUSH();
         printf("Error: Unknown opcode '%s'\n", opcode);
         return 0;
     }
@@ -155,35 +312,60 @@ uint32_t parseInstruction(char* line, SymbolTable* table) {
     
     // 1-13 bits are address (from left to right, leftmost is 2^0)
     int addr = 0;
+    int mode = MODE_DIRECT;
+    bool indexed = false;
     if (operand) {
-        if (isdigit(*operand)) {
+        operand = splitOperand(operand, &mode, &indexed);
+        if (isNumericOperand(operand)) {
             addr = atoi(operand);
+            // Immediates and addresses are unsigned 13-bit fields; only *-n may go backwards
+            if (addr < 0 && mode != MODE_RELATIVE) {
+                LOG_FLUSH();
+                printf("Error: Negative operand '%s' is only allowed as a relative offset (*-n)\n", operand);
+                return 0;
+            }
+            if (addr > 8191 || addr < -8191) {
+                LOG_FLUSH();
+                printf("Error: Operand '%s' does not fit in 13 bits (%s)\n", operand,
+                       mode == MODE_RELATIVE ? "-8191 to 8191" : "0 to 8191");
+                return 0;
+            }
+        } else if (mode == MODE_RELATIVE) {
+            LOG_FLUSH();
+            printf("Error: Relative operand needs a number, not symbol '%s'\n", operand);
+            return 0;
         } else {
             addr = findSymbol(table, operand);
             if (addr == -1) {
+                LOG_FLUSH();
                 printf("Error: Undefined symbol '%s'\n", operand);
                 return 0;
             }
         }
     }
     
-    // Place address (1-13 bits)
-    for (int i = 0; i < 13; i++) {
-        if (addr & (1 << i)) {
-            instruction |= (1UL << (32 - 1 - i));
-        }
-    }
+    // Place address (1-13 bits), then the addressing mode (19-21 bits)
+    instruction |= encodeAddress(addr);
+    instruction |= encodeMode(mode, indexed);
     
     // 14-17 bits are opcode
-    instruction |= ((uint32_t)op << (32 - 17));  // Place opcode in bits 14-17
+    instruction |= encodeOpcode(op);  // Place opcode in bits 14-18
     
     return instruction;
 }
 
+// Check for a GLOBAL directive, which exports a label and occupies no word
+bool isGlobalDirective(const char *line) {
+    while (isspace(*line)) line++;
+    return strncmp(line, "GLOBAL", 6) == 0 &&
+           (line[6] == '\0' || line[6] == ';' || isspace(line[6]));
+}
+
 // First pass: collect all labels and their addresses
 int firstPass(AssemblerState *state) {
-    FILE *fp = fopen(state->inputFileName, "r");
+    FILE *fp = openSource(state);
     if (!fp) {
+        LOG_FLUSH();
         printf("Error: Unable to open input file '%s'\n", state->inputFileName);
         return -1;
     }
@@ -195,7 +377,7 @@ int firstPass(AssemblerState *state) {
         // Skip empty lines and pure comment lines
         char *p = line;
         while (isspace(*p)) p++;
-        if (*p == ';' || *p == '\0') {
+        if (*p == ';' || *p == '\0' || isGlobalDirective(p)) {
             continue;
         }
         
@@ -222,24 +404,24 @@ int firstPass(AssemblerState *state) {
                     fclose(fp);
                     return -1;
                 }
-                if (state->verbose) {
-                    printf("Found label '%s' at address %d\n", start, address);
-                }
+                LOG_AT(state->logLevel, LOG_INSTRUCTION, "Found label '%s' at address %d\n", start, address);
             }
         }
         address++;
     }
     
     fclose(fp);
+    LOG_FLUSH();
     return 0;
 }
 
 // Second pass: generate machine code
 int secondPass(AssemblerState *state) {
-    FILE *inFp = fopen(state->inputFileName, "r");
-    FILE *outFp = fopen(state->outputFileName, "w");
+    FILE *inFp = openSource(state);
+    FILE *outFp = openOutput(state->outputFileName);
     
     if (!inFp || !outFp) {
+        LOG_FLUSH();
         printf("Error: Unable to open file\n");
         if (inFp) fclose(inFp);
         if (outFp) fclose(outFp);
@@ -252,7 +434,7 @@ int secondPass(AssemblerState *state) {
     while (fgets(line, sizeof(line), inFp)) {
         char *p = line;
         while (isspace(*p)) p++;
-        if (*p == ';' || *p == '\0') continue;
+        if (*p == ';' || *p == '\0' || isGlobalDirective(p)) continue;
         
         uint32_t instruction = parseInstruction(line, &state->symbolTable);
         
@@ -262,40 +444,458 @@ int secondPass(AssemblerState *state) {
         }
         fprintf(outFp, "\n");
         
-        if (state->verbose) {
-            printf("Line %2d: ", lineNum + 1);
+        if (LOG_ENABLED(state->logLevel, LOG_INSTRUCTION)) {
+            char bits[33];
             for (int i = 31; i >= 0; i--) {
-                printf("%d", (instruction >> i) & 1);
+                bits[31 - i] = '0' + ((instruction >> i) & 1);
             }
-            printf("\n");
+            bits[32] = '\0';
+            log_printf("Line %2d: %s\n", lineNum + 1, bits);
         }
         lineNum++;
     }
     
     fclose(inFp);
     fclose(outFp);
+    LOG_FLUSH();
+    return 0;
+}
+
+// Object pass: generate relocatable code, exports and relocation entries
+int writeObject(AssemblerState *state) {
+    FILE *inFp = openSource(state);
+    if (!inFp) {
+        LOG_FLUSH();
+        printf("Error: Unable to open input file '%s'\n", state->inputFileName);
+        return -1;
+    }
+
+    int capacity = MEMORY_SIZE;
+    uint32_t *words = malloc(capacity * sizeof(uint32_t));
+    Relocation *relocs = malloc(capacity * sizeof(Relocation));
+    SymbolTable exports;
+    SymbolTable imports;
+    exports.count = 0;
+    imports.count = 0;
+    int wordCount = 0;
+    int relocCount = 0;
+    int status = 0;
+
+    char line[MAX_LINE_LENGTH];
+    char copy[MAX_LINE_LENGTH];
+    while (fgets(line, sizeof(line), inFp)) {
+        char *p = line;
+        while (isspace(*p)) p++;
+        if (*p == ';' || *p == '\0') continue;
+
+        char *opcode, *operand;
+        strcpy(copy, line);
+        bool hasOpcode = tokenizeLine(copy, &opcode, &operand);
+
+        // GLOBAL <label>: export a label defined in this module
+        if (isGlobalDirective(p)) {
+            int addr = (hasOpcode && operand && *operand) ? findSymbol(&state->symbolTable, operand) : -1;
+            if (addr < 0) {
+                LOG_FLUSH();
+                printf("Error: GLOBAL needs a label defined in this module\n");
+                status = -1;
+            } else if (findSymbol(&exports, operand) < 0) {
+                addSymbol(&exports, operand, addr);
+            }
+            continue;
+        }
+
+        if (wordCount == capacity) {
+            capacity *= 2;
+            words = realloc(words, capacity * sizeof(uint32_t));
+            relocs = realloc(relocs, capacity * sizeof(Relocation));
+        }
+
+        // Symbolic operands are relocated: local labels by the module base,
+        // undefined ones become imports resolved by the linker
+        int mode = MODE_DIRECT;
+        bool indexed = false;
+        if (hasOpcode && operand && strcmp(opcode, "VAR") != 0) {
+            operand = splitOperand(operand, &mode, &indexed);
+        }
+        bool symbolic = hasOpcode && operand && *operand && !isNumericOperand(operand) &&
+                        mode != MODE_RELATIVE && strcmp(opcode, "VAR") != 0 && strcmp(opcode, "STP") != 0;
+        uint32_t instruction;
+        if (symbolic && findSymbol(&state->symbolTable, operand) < 0 && lookupOpcode(opcode) >= 0) {
+            instruction = encodeOpcode(lookupOpcode(opcode)) | encodeMode(mode, indexed);
+            relocs[relocCount].word = wordCount;
+            strcpy(relocs[relocCount].symbol, operand);
+            relocCount++;
+            if (findSymbol(&imports, operand) < 0 && addSymbol(&imports, operand, 0) < 0) {
+                status = -1;
+            }
+        } else {
+            instruction = parseInstruction(line, &state->symbolTable);
+            if (symbolic) {
+                relocs[relocCount].word = wordCount;
+                relocs[relocCount].symbol[0] = '\0';
+                relocCount++;
+            }
+        }
+        words[wordCount++] = instruction;
+    }
+    fclose(inFp);
+
+    FILE *outFp = status == 0 ? openOutput(state->outputFileName) : NULL;
+    if (status == 0 && !outFp) {
+        LOG_FLUSH();
+        printf("Error: Unable to open output file '%s'\n", state->outputFileName);
+        status = -1;
+    }
+    if (outFp) {
+        fprintf(outFp, "%s\n", OBJECT_MAGIC);
+        fprintf(outFp, "WORDS %d\n", wordCount);
+        for (int w = 0; w < wordCount; w++) {
+            for (int i = 31; i >= 0; i--) {
+                fprintf(outFp, "%d", (words[w] >> i) & 1);
+            }
+            fprintf(outFp, "\n");
+        }
+        for (int i = 0; i < exports.count; i++) {
+            fprintf(outFp, "EXPORT %s %d\n", exports.symbols[i].name, exports.symbols[i].address);
+        }
+        for (int i = 0; i < imports.count; i++) {
+            fprintf(outFp, "IMPORT %s\n", imports.symbols[i].name);
+        }
+        for (int i = 0; i < relocCount; i++) {
+            if (relocs[i].symbol[0]) {
+                fprintf(outFp, "RELOC %d %s\n", relocs[i].word, relocs[i].symbol);
+            } else {
+                fprintf(outFp, "RELOC %d\n", relocs[i].word);
+            }
+        }
+        fprintf(outFp, "END\n");
+        fclose(outFp);
+
+        LOG_AT(state->logLevel, LOG_INSTRUCTION, "Object: %d words, %d exports, %d imports, %d relocations\n",
+               wordCount, exports.count, imports.count, relocCount);
+    }
+
+    free(words);
+    free(relocs);
+    LOG_FLUSH();
+    return status;
+}
+
+// Assemble a module into a relocatable object file
+int assembleObject(const char *inputFile, const char *outputFile, int logLevel) {
+    AssemblerState state;
+    initAssembler(&state, inputFile, outputFile);
+    state.logLevel = logLevel;
+
+    LOG_AT(logLevel, LOG_SUMMARY, "Starting assembly of object '%s'...\n", outputFile);
+
+    if (firstPass(&state) < 0) {
+        LOG_FLUSH();
+        printf("First pass failed\n");
+        return -1;
+    }
+
+    if (writeObject(&state) < 0) {
+        LOG_FLUSH();
+        printf("Object generation failed\n");
+        return -1;
+    }
+
+    LOG_AT(logLevel, LOG_SUMMARY, "Assembly completed\n");
+    LOG_FLUSH();
     return 0;
 }
 
 // Main assembly function
-int assemble(const char *inputFile, const char *outputFile, bool verbose) {
+int assemble(const char *inputFile, const char *outputFile, int logLevel) {
     AssemblerState state;
     initAssembler(&state, inputFile, outputFile);
-    state.verbose = verbose;
+    state.logLevel = logLevel;
     
-    printf("Starting assembly...\n");
+    LOG_AT(logLevel, LOG_SUMMARY, "Starting assembly...\n");
     
     if (firstPass(&state) < 0) {
+        LOG_FLUSH();
         printf("First pass failed\n");
         return -1;
     }
     
     if (secondPass(&state) < 0) {
+        LOG_FLUSH();
         printf("Second pass failed\n");
         return -1;
     }
     
-    printf("Assembly completed\n");
+    LOG_AT(logLevel, LOG_SUMMARY, "Assembly completed\n");
+    LOG_FLUSH();
+    return 0;
+}
+
+// Record label, operand reference and word flag of a watched source line
+static void scanSourceLine(SourceLine *sl, char *text) {
+    char copy[MAX_LINE_LENGTH];
+    char *p = text;
+
+    sl->text = text;
+    sl->label = NULL;
+    sl->reference = NULL;
+    sl->dirty = true;
+    sl->refAddress = -1;
+    sl->word = 0;
+
+    while (isspace(*p)) p++;
+    sl->emitsWord = !(*p == ';' || *p == '\0' || isGlobalDirective(p));
+    if (!sl->emitsWord) return;
+
+    // Label, extracted the same way as firstPass
+    strcpy(copy, text);
+    char *comment = strchr(copy, ';');
+    if (comment) *comment = '\0';
+    char *colon = strchr(copy, ':');
+    if (colon) {
+        *colon = '\0';
+        char *start = copy;
+        while (isspace(*start)) start++;
+        char *end = start + strlen(start) - 1;
+        while (end > start && isspace(*end)) *end-- = '\0';
+        if (*start && strcmp(start, "VAR") != 0) {
+            sl->label = strdup(start);
+        }
+    }
+
+    // Symbolic operand, extracted the same way as parseInstruction
+    char *opcode, *operand;
+    int mode;
+    bool indexed;
+    strcpy(copy, text);
+    if (tokenizeLine(copy, &opcode, &operand) && operand && strcmp(opcode, "VAR") != 0 &&
+        strcmp(opcode, "STP") != 0) {
+        operand = splitOperand(operand, &mode, &indexed);
+        if (*operand && !isNumericOperand(operand) && mode != MODE_RELATIVE) {
+            sl->reference = strdup(operand);
+        }
+    }
+}
+
+static void freeSourceLine(SourceLine *sl) {
+    free(sl->text);
+    free(sl->label);
+    free(sl->reference);
+}
+
+// Read all lines of a file with the same fgets chunking as the two passes
+static int readSourceText(const char *fileName, char ***texts, int *count) {
+    FILE *fp = fopen(fileName, "r");
+    if (!fp) {
+        LOG_FLUSH();
+        printf("Error: Unable to open input file '%s'\n", fileName);
+        return -1;
+    }
+
+    char line[MAX_LINE_LENGTH];
+    int capacity = 256;
+    *texts = malloc(capacity * sizeof(char *));
+    *count = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (*count == capacity) {
+            capacity *= 2;
+            *texts = realloc(*texts, capacity * sizeof(char *));
+        }
+        (*texts)[(*count)++] = strdup(line);
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+static bool symbolTablesEqual(const SymbolTable *a, const SymbolTable *b) {
+    if (a->count != b->count) return false;
+    for (int i = 0; i < a->count; i++) {
+        if (a->symbols[i].address != b->symbols[i].address ||
+            strcmp(a->symbols[i].name, b->symbols[i].name) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Merge new source text into the cache, re-encode what changed and patch the output file
+static int reassembleChanges(WatchState *ws, char **texts, int count) {
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    // Unchanged prefix and suffix keep their cached tokens and encodings
+    int prefix = 0;
+    while (prefix < count && prefix < ws->lineCount &&
+           strcmp(ws->lines[prefix].text, texts[prefix]) == 0) {
+        prefix++;
+    }
+    int suffix = 0;
+    while (suffix < count - prefix && suffix < ws->lineCount - prefix &&
+           strcmp(ws->lines[ws->lineCount - 1 - suffix].text, texts[count - 1 - suffix]) == 0) {
+        suffix++;
+    }
+
+    SourceLine *lines = malloc((count > 0 ? count : 1) * sizeof(SourceLine));
+    for (int i = 0; i < prefix; i++) {
+        lines[i] = ws->lines[i];
+        free(texts[i]);
+    }
+    for (int i = prefix; i < count - suffix; i++) {
+        scanSourceLine(&lines[i], texts[i]);
+    }
+    for (int i = 0; i < suffix; i++) {
+        lines[count - 1 - i] = ws->lines[ws->lineCount - 1 - i];
+        free(texts[count - 1 - i]);
+    }
+    for (int i = prefix; i < ws->lineCount - suffix; i++) {
+        freeSourceLine(&ws->lines[i]);
+    }
+    free(ws->lines);
+    free(texts);
+    ws->lines = lines;
+    ws->lineCount = count;
+    int changedLines = count - suffix - prefix;
+
+    // Rebuild the symbol table from cached labels (same rules as firstPass)
+    SymbolTable table;
+    table.count = 0;
+    int wordCount = 0;
+    for (int i = 0; i < count; i++) {
+        if (!lines[i].emitsWord) continue;
+        if (lines[i].label && wordCount < MEMORY_SIZE) {
+            if (addSymbol(&table, lines[i].label, wordCount) < 0) {
+                LOG_FLUSH();
+                printf("Reassembly failed, waiting for the next change\n");
+                return -1;
+            }
+        }
+        wordCount++;
+    }
+    bool symbolsMoved = !symbolTablesEqual(&table, &ws->symbolTable);
+    ws->symbolTable = table;
+
+    // Encode changed lines and re-resolve references to labels that moved
+    uint32_t *image = malloc((wordCount > 0 ? wordCount : 1) * sizeof(uint32_t));
+    int address = 0;
+    for (int i = 0; i < count; i++) {
+        SourceLine *sl = &lines[i];
+        if (!sl->emitsWord) continue;
+
+        int refAddress = -1;
+        if (sl->reference && (sl->dirty || symbolsMoved)) {
+            refAddress = findSymbol(&ws->symbolTable, sl->reference);
+        }
+        if (sl->dirty || (symbolsMoved && sl->reference && refAddress != sl->refAddress)) {
+            if (!sl->dirty && refAddress >= 0 && sl->refAddress >= 0) {
+                // Only the operand field depends on the moved label
+                sl->word = (sl->word & ~ADDRESS_MASK) | encodeAddress(refAddress);
+            } else {
+                char copy[MAX_LINE_LENGTH];
+                strcpy(copy, sl->text);
+                sl->word = parseInstruction(copy, &ws->symbolTable);
+            }
+            sl->refAddress = refAddress;
+            sl->dirty = false;
+        }
+        image[address++] = sl->word;
+    }
+
+    // Rewrite only the words that differ from the file contents
+    int rewritten = 0;
+    char text[OUTPUT_WORD_BYTES];
+    for (int i = 0; i < wordCount; i++) {
+        if (i < ws->wordCount && ws->image[i] == image[i]) continue;
+        for (int b = 31; b >= 0; b--) {
+            text[31 - b] = '0' + ((image[i] >> b) & 1);
+        }
+        text[32] = '\n';
+        if (pwrite(ws->outputFd, text, OUTPUT_WORD_BYTES, (off_t)i * OUTPUT_WORD_BYTES) != OUTPUT_WORD_BYTES) {
+            LOG_FLUSH();
+            printf("Error: Unable to write output file\n");
+            free(image);
+            return -1;
+        }
+        LOG_AT(ws->logLevel, LOG_INSTRUCTION, "Word %2d: %.32s\n", i, text);
+        rewritten++;
+    }
+    if (wordCount < ws->wordCount &&
+        ftruncate(ws->outputFd, (off_t)wordCount * OUTPUT_WORD_BYTES) < 0) {
+        LOG_FLUSH();
+        printf("Error: Unable to truncate output file\n");
+    }
+    free(ws->image);
+    ws->image = image;
+    ws->wordCount = wordCount;
+
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double ms = (finished.tv_sec - started.tv_sec) * 1e3 +
+                (finished.tv_nsec - started.tv_nsec) / 1e6;
+    LOG_AT(ws->logLevel, LOG_SUMMARY, "Reassembled: %d line(s) changed, %d word(s) rewritten, %d words total (%.3f ms)\n",
+           changedLines, rewritten, wordCount, ms);
+    LOG_FLUSH();
+    fflush(stdout);
+    return 0;
+}
+
+// Watch mode: assemble once, then reassemble incrementally whenever the source is saved
+int watchAndAssemble(const char *inputFile, const char *outputFile, int logLevel) {
+    WatchState ws;
+    memset(&ws, 0, sizeof(ws));
+    ws.logLevel = logLevel;
+
+    ws.outputFd = open(outputFile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (ws.outputFd < 0) {
+        LOG_FLUSH();
+        printf("Error: Unable to open output file '%s'\n", outputFile);
+        return -1;
+    }
+
+    // Watch the directory so editors that save by rename are also noticed
+    char dirCopy[MAX_LINE_LENGTH], baseCopy[MAX_LINE_LENGTH];
+    snprintf(dirCopy, sizeof(dirCopy), "%s", inputFile);
+    snprintf(baseCopy, sizeof(baseCopy), "%s", inputFile);
+    const char *dirName = dirname(dirCopy);
+    const char *baseName = basename(baseCopy);
+
+    int notifyFd = inotify_init();
+    if (notifyFd < 0 || inotify_add_watch(notifyFd, dirName, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        LOG_FLUSH();
+        printf("Error: Unable to watch '%s'\n", dirName);
+        close(ws.outputFd);
+        return -1;
+    }
+
+    LOG_AT(logLevel, LOG_SUMMARY, "Watching '%s' (Ctrl-C to stop)\n", inputFile);
+    LOG_FLUSH();
+    char **texts;
+    int count;
+    if (readSourceText(inputFile, &texts, &count) == 0) {
+        reassembleChanges(&ws, texts, count);
+    }
+
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (1) {
+        ssize_t len = read(notifyFd, events, sizeof(events));
+        if (len <= 0) break;
+
+        // Coalesce a burst of events into a single reassembly
+        bool changed = false;
+        for (char *ptr = events; ptr < events + len; ) {
+            struct inotify_event *event = (struct inotify_event *)ptr;
+            if (event->len && strcmp(event->name, baseName) == 0) {
+                changed = true;
+            }
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+        if (changed && readSourceText(inputFile, &texts, &count) == 0) {
+            reassembleChanges(&ws, texts, count);
+        }
+    }
+
+    close(notifyFd);
+    close(ws.outputFd);
     return 0;
 }
 
@@ -326,6 +926,7 @@ int is_assembly_file(const char* filename) {
         // Check if it contains typical assembly language features (labels, instructions, etc.)
         if (strstr(line, ":") ||          // Contains labels
             strstr(line, "VAR") ||        // VAR instruction
+            strstr(line, "GLOBAL") ||     // Exported label of a module
             strstr(line, "LDN") ||        // Other instructions
             strstr(line, "ADD") ||
             strstr(line, "SUB") ||
@@ -340,12 +941,56 @@ int is_assembly_file(const char* filename) {
     return valid;
 }
 
+#ifndef BABY_NO_MAIN
 // Main function
 int main(int argc, char* argv[]) {
-    bool verbose = true;
+    int logLevel = LOG_INSTRUCTION;
+    bool watch = false;
+    bool object = false;
     char inputFileName[256];
     char outputFileName[256];
 
+    // Command line mode: <input file> <output file> [-q] [--watch]
+    if (argc > 1) {
+        if (argc < 3) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "-q") == 0) {
+                logLevel = LOG_SUMMARY;
+            } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc &&
+                       log_parse_level(argv[i + 1]) >= LOG_OFF) {
+                logLevel = log_parse_level(argv[++i]);
+            } else if (strcmp(argv[i], "--watch") == 0) {
+                watch = true;
+            } else if (strcmp(argv[i], "-c") == 0) {
+                object = true;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        if (watch && object) {
+            printf("Error: --watch cannot be combined with -c\n");
+            return 1;
+        }
+        if (watch && (strcmp(argv[1], "-") == 0 || strcmp(argv[2], "-") == 0)) {
+            printf("Error: --watch needs named input and output files\n");
+            return 1;
+        }
+        if (strcmp(argv[2], "-") == 0) {
+            redirectMessagesToStderr();
+        }
+        if (watch) {
+            return watchAndAssemble(argv[1], argv[2], logLevel);
+        }
+        if (object) {
+            return assembleObject(argv[1], argv[2], logLevel);
+        }
+        return assemble(argv[1], argv[2], logLevel);
+    }
+
     // Handle input file
     while (1) {
         printf("Enter the name/path of the file you want to convert: ");
@@ -389,5 +1034,6 @@ int main(int argc, char* argv[]) {
     printf("The name of the file to be converted: %s\n", inputFileName);
     printf("File name converted to machine code: %s\n", outputFileName);
 
-    return assemble(inputFileName, outputFileName, verbose);
-}
\ No newline at end of file
+    return assemble(inputFileName, outputFileName, logLevel);
+}
+#endif
@@ -1,8 +1,10 @@
 #ifndef ASSEMBLER_H
 #define ASSEMBLER_H
 
+#include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "log.h"
 
 // Maximum allowed symbols in symbol table
 #define MAX_SYMBOLS 100
@@ -28,16 +30,69 @@ typedef struct {
     SymbolTable symbolTable;    // Table for storing symbols and their addresses
     char *inputFileName;        // Input assembly file path
     char *outputFileName;       // Output machine code file path
-    bool verbose;               // Verbose output flag
+    int logLevel;               // Message verbosity (LogLevel)
+    char *source;               // Buffered stdin when the input file is "-"
+    size_t sourceLength;        // Bytes in the source buffer
 } AssemblerState;
 
+// Mask of the 13-bit operand field inside an encoded instruction
+#define ADDRESS_MASK 0xFFF80000u
+// Bytes per word in the text output format (32 digits plus newline)
+#define OUTPUT_WORD_BYTES 33
+
+// First line of a relocatable object file
+#define OBJECT_MAGIC "BABYOBJ 1"
+
+// Relocation entry: operand field of a word that must be patched at link time
+typedef struct {
+    int word;                       // Word index within the module
+    char symbol[MAX_LINE_LENGTH];   // Imported symbol, or "" to add the module base
+} Relocation;
+
+// Cached per-line state kept by watch mode between reassemblies
+typedef struct {
+    char *text;                 // Raw source line as read by fgets
+    char *label;                // Label defined on this line (NULL if none)
+    char *reference;            // Symbol used as operand (NULL if none)
+    bool emitsWord;             // False for blank and comment-only lines
+    bool dirty;                 // Line text changed since it was last encoded
+    int refAddress;             // Address the reference resolved to (-1 if undefined)
+    uint32_t word;              // Cached machine code for this line
+} SourceLine;
+
+// Watch mode state: parsed source, symbols and the image last written
+typedef struct {
+    SourceLine *lines;          // Cached source lines
+    int lineCount;              // Number of cached lines
+    SymbolTable symbolTable;    // Symbols of the last successful reassembly
+    uint32_t *image;            // Words currently in the output file
+    int wordCount;              // Number of words in the output file
+    int outputFd;               // Output file, rewritten in place
+    int logLevel;               // Message verbosity (LogLevel)
+} WatchState;
+
 // Function declarations
-int assemble(const char *inputFile, const char *outputFile, bool verbose);
+int assemble(const char *inputFile, const char *outputFile, int logLevel);
 void initAssembler(AssemblerState *state, const char *inputFile, const char *outputFile);
+FILE *openSource(AssemblerState *state);
+FILE *openOutput(const char *outputFile);
+void redirectMessagesToStderr(void);
 int firstPass(AssemblerState *state);
 int secondPass(AssemblerState *state);
 int addSymbol(SymbolTable *table, const char *name, int address);
 int findSymbol(SymbolTable *table, const char *name);
 uint32_t parseInstruction(char *line, SymbolTable *table);
+bool tokenizeLine(char *line, char **opcode, char **operand);
+uint32_t encodeAddress(int addr);
+int lookupOpcode(const char *opcode);
+uint32_t encodeOpcode(int op);
+uint32_t encodeMode(int mode, bool indexed);
+char *splitOperand(char *operand, int *mode, bool *indexed);
+bool isNumericOperand(const char *operand);
+int decodeAddress(uint32_t instruction);
+bool isGlobalDirective(const char *line);
+int writeObject(AssemblerState *state);
+int assembleObject(const char *inputFile, const char *outputFile, int logLevel);
+int watchAndAssemble(const char *inputFile, const char *outputFile, int logLevel);
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "babyd.h"
+#include "engine.h"
+
+// Ways per program cache set; a full set evicts its least recently used entry
+#define CACHE_WAYS 4
+// Per-connection buffer size; replies are flushed once the pending requests are answered
+#define IO_BUFFER 65536
+
+// One cached, pre-decoded program
+typedef struct {
+    DecodedProgram program;     // Image and decoded words
+    uint64_t check;             // Independent hash of the image, tells apart programs sharing an id
+    int valid;                  // Entry holds a program
+    atomic_ullong last_used;    // Cache clock value of the last LOAD or RUN
+} CacheEntry;
+
+// Set-associative cache of decoded programs keyed by content hash
+typedef struct {
+    CacheEntry* entries;        // sets * CACHE_WAYS entries
+    int sets;                   // Number of sets (power of two)
+    pthread_rwlock_t lock;      // Readers run programs, writers insert them
+    atomic_ullong clock;        // Advances on every lookup
+} ProgramCache;
+
+static ProgramCache cache;
+static int listen_fd = -1;
+static atomic_ullong requests_served;
+static atomic_ullong cache_misses;
+
+// Display program usage information
+void printDaemonUsage(const char* programName) {
+    printf("Usage: %s [--socket PATH] [--machines N] [--cache N]\n", programName);
+    printf("Options:\n");
+    printf("  --socket PATH  Unix socket to listen on (default %s)\n", BABYD_DEFAULT_SOCKET);
+    printf("  --machines N   Preallocated machines, one per concurrent connection (default 4)\n");
+    printf("  --cache N      Decoded programs kept in memory (default 1024)\n");
+}
+
+// Find a cached program; the caller holds the cache lock
+static CacheEntry* cache_find(uint64_t hash) {
+    CacheEntry* set = &cache.entries[(hash & (cache.sets - 1)) * CACHE_WAYS];
+    for (int w = 0; w < CACHE_WAYS; w++) {
+        if (set[w].valid && set[w].program.hash == hash) {
+            atomic_store_explicit(&set[w].last_used, atomic_fetch_add(&cache.clock, 1),
+                                  memory_order_relaxed);
+            return &set[w];
+        }
+    }
+    return NULL;
+}
+
+// Second hash of a program image, seeded differently from its id
+static uint64_t program_check(const DecodedProgram* program) {
+    return engine_hash(program->words, program->memory_size * sizeof(uint32_t),
+                       0x434845434bULL ^ (uint64_t)program->memory_size);
+}
+
+// Insert a decoded program, replacing the least recently used way of its set;
+// returns -1 when its id already names a different cached program
+static int cache_insert(const DecodedProgram* program) {
+    int status = 0;
+    uint64_t check = program_check(program);
+    pthread_rwlock_wrlock(&cache.lock);
+    CacheEntry* existing = cache_find(program->hash);
+    if (existing) {
+        if (existing->check != check || existing->program.memory_size != program->memory_size) {
+            status = -1;
+        }
+    } else {
+        CacheEntry* set = &cache.entries[(program->hash & (cache.sets - 1)) * CACHE_WAYS];
+        CacheEntry* victim = &set[0];
+        for (int w = 0; w < CACHE_WAYS; w++) {
+            if (!set[w].valid) {
+                victim = &set[w];
+                break;
+            }
+            if (atomic_load(&set[w].last_used) < atomic_load(&victim->last_used)) {
+                victim = &set[w];
+            }
+        }
+        memcpy(&victim->program, program, sizeof(DecodedProgram));
+        victim->check = check;
+        victim->valid = 1;
+        atomic_store(&victim->last_used, atomic_fetch_add(&cache.clock, 1));
+    }
+    pthread_rwlock_unlock(&cache.lock);
+    return status;
+}
+
+// Payload bytes that follow a request header
+static size_t payload_size(const BabydRequest* request) {
+    return request->type == BABYD_LOAD ? request->count * sizeof(uint32_t)
+                                       : request->count * sizeof(BabydPoke);
+}
+
+// Answer one complete request into out; returns the reply size
+static size_t handle_request(PackedMachine* machine, const BabydRequest* request,
+                             const unsigned char* payload, unsigned char* out) {
+    BabydReply reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.magic = BABYD_MAGIC;
+    reply.tag = request->tag;
+    reply.program_id = request->program_id;
+    reply.status = BABYD_OK;
+    atomic_fetch_add_explicit(&requests_served, 1, memory_order_relaxed);
+
+    if (request->type == BABYD_LOAD) {
+        if ((request->memory_size != 32 && request->memory_size != 64) ||
+            request->count > request->memory_size) {
+            reply.status = BABYD_BAD_REQUEST;
+        } else {
+            uint32_t words[BABYD_MAX_WORDS];
+            DecodedProgram program;
+            memcpy(words, payload, request->count * sizeof(uint32_t));
+            engine_prepare(&program, words, request->count, request->memory_size);
+            if (cache_insert(&program) != 0) {
+                reply.status = BABYD_ID_CONFLICT;
+            } else {
+                reply.program_id = program.hash;
+            }
+        }
+        memcpy(out, &reply, sizeof(reply));
+        return sizeof(reply);
+    }
+
+    // RUN: copy the cached image into this thread's machine, then run unlocked
+    pthread_rwlock_rdlock(&cache.lock);
+    CacheEntry* entry = cache_find(request->program_id);
+    if (entry) {
+        engine_reset(machine, &entry->program);
+    }
+    pthread_rwlock_unlock(&cache.lock);
+    if (!entry) {
+        atomic_fetch_add_explicit(&cache_misses, 1, memory_order_relaxed);
+        reply.status = BABYD_UNKNOWN_PROGRAM;
+        memcpy(out, &reply, sizeof(reply));
+        return sizeof(reply);
+    }
+
+    for (int i = 0; i < request->count; i++) {
+        BabydPoke poke;
+        memcpy(&poke, payload + i * sizeof(poke), sizeof(poke));
+        engine_poke(machine, (int)(poke.address % (uint32_t)machine->memory_size), poke.value);
+    }
+    long long budget = request->step_budget > (uint64_t)LLONG_MAX ? LLONG_MAX
+                                                                  : (long long)request->step_budget;
+    engine_run(machine, budget);
+
+    reply.accumulator = machine->accumulator;
+    reply.CI = machine->CI;
+    reply.running = machine->running;
+    reply.cycles = (uint64_t)machine->cycles;
+    reply.count = (uint16_t)machine->memory_size;
+    memcpy(out, &reply, sizeof(reply));
+    memcpy(out + sizeof(reply), machine->words, machine->memory_size * sizeof(uint32_t));
+    return sizeof(reply) + machine->memory_size * sizeof(uint32_t);
+}
+
+// Write a whole buffer to the connection
+static int write_all(int fd, const unsigned char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+// Serve pipelined requests on one connection until the client hangs up
+static void serve_connection(int fd, PackedMachine* machine) {
+    unsigned char* in = malloc(IO_BUFFER);
+    unsigned char* out = malloc(IO_BUFFER);
+    const size_t largest_reply = sizeof(BabydReply) + BABYD_MAX_WORDS * sizeof(uint32_t);
+    size_t have = 0;
+    int open = 1;
+
+    while (open) {
+        ssize_t n = read(fd, in + have, IO_BUFFER - have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        have += (size_t)n;
+
+        // Answer every complete request in the buffer, then send the replies together
+        size_t used = 0, pending = 0;
+        while (have - used >= sizeof(BabydRequest)) {
+            if (pending + largest_reply > IO_BUFFER) {
+                if (write_all(fd, out, pending) < 0) {
+                    open = 0;
+                    break;
+                }
+                pending = 0;
+            }
+            BabydRequest request;
+            memcpy(&request, in + used, sizeof(request));
+            if (request.magic != BABYD_MAGIC || request.count > BABYD_MAX_WORDS ||
+                (request.type != BABYD_LOAD && request.type != BABYD_RUN)) {
+                // The stream cannot be resynchronised: report and hang up
+                BabydReply reply;
+                memset(&reply, 0, sizeof(reply));
+                reply.magic = BABYD_MAGIC;
+                reply.status = BABYD_BAD_REQUEST;
+                reply.tag = request.tag;
+                memcpy(out + pending, &reply, sizeof(reply));
+                pending += sizeof(reply);
+                open = 0;
+                break;
+            }
+            size_t size = sizeof(request) + payload_size(&request);
+            if (have - used < size) break;
+            pending += handle_request(machine, &request, in + used + sizeof(request), out + pending);
+            used += size;
+        }
+        if (pending > 0 && write_all(fd, out, pending) < 0) break;
+        memmove(in, in + used, have - used);
+        have -= used;
+    }
+
+    free(in);
+    free(out);
+}
+
+// Worker thread: owns one preallocated machine and serves one connection at a time
+static void* worker(void* arg) {
+    PackedMachine* machine = arg;
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        serve_connection(fd, machine);
+        close(fd);
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    const char* socket_path = BABYD_DEFAULT_SOCKET;
+    int machine_count = 4;
+    int cache_size = 1024;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--machines") == 0 && i + 1 < argc) {
+            machine_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_size = atoi(argv[++i]);
+        } else {
+            printDaemonUsage(argv[0]);
+            return 1;
+        }
+    }
+    struct sockaddr_un addr;
+    if (machine_count <= 0 || cache_size <= 0 || strlen(socket_path) >= sizeof(addr.sun_path)) {
+        printDaemonUsage(argv[0]);
+        return 1;
+    }
+
+    // Round the cache up to a power-of-two number of sets
+    cache.sets = 1;
+    while (cache.sets * CACHE_WAYS < cache_size) cache.sets <<= 1;
+    cache.entries = calloc((size_t)cache.sets * CACHE_WAYS, sizeof(CacheEntry));
+    pthread_rwlock_init(&cache.lock, NULL);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    unlink(socket_path);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, 64) < 0) {
+        printf("Error: Unable to listen on '%s': %s\n", socket_path, strerror(errno));
+        return 1;
+    }
+
+    // Workers never see SIGINT/SIGTERM; the main thread waits for them to shut down cleanly
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    PackedMachine* machines = calloc(machine_count, sizeof(PackedMachine));
+    for (int i = 0; i < machine_count; i++) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, worker, &machines[i]);
+        pthread_detach(thread);
+    }
+    printf("babyd: listening on %s with %d machines, %d cached programs\n",
+           socket_path, machine_count, cache.sets * CACHE_WAYS);
+    fflush(stdout);
+
+    int sig;
+    sigwait(&stop_signals, &sig);
+    unlink(socket_path);
+    printf("babyd: served %llu requests (%llu runs of uncached programs)\n",
+           (unsigned long long)atomic_load(&requests_served),
+           (unsigned long long)atomic_load(&cache_misses));
+    return 0;
+}
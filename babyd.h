@@ -0,0 +1,59 @@
+#ifndef BABYD_H
+#define BABYD_H
+
+#include <stdint.h>
+
+// Wire protocol of babyd. Messages are fixed-size headers in host byte order
+// (the socket is local) followed by a payload; clients may send any number of
+// requests before reading replies, which come back in request order.
+
+#define BABYD_MAGIC 0x44594242u             // "BBYD"
+#define BABYD_DEFAULT_SOCKET "/tmp/babyd.sock"
+// Largest store a request may use
+#define BABYD_MAX_WORDS 64
+
+// Request types
+typedef enum {
+    BABYD_LOAD = 1,             // Payload: count store words; reply carries the program id
+    BABYD_RUN = 2               // Payload: count BabydPoke entries applied before the run
+} BabydRequestType;
+
+// Reply status codes
+typedef enum {
+    BABYD_OK = 0,
+    BABYD_UNKNOWN_PROGRAM = 1,  // Program id not (or no longer) cached: LOAD it again
+    BABYD_BAD_REQUEST = 2,      // Malformed header or payload
+    BABYD_ID_CONFLICT = 3       // LOAD: the program's id already names a different cached program
+} BabydStatus;
+
+// Request header
+typedef struct {
+    uint32_t magic;             // BABYD_MAGIC
+    uint16_t type;              // BabydRequestType
+    uint16_t count;             // Payload entries following the header
+    uint32_t memory_size;       // LOAD: store size, 32 or 64
+    uint32_t tag;               // Echoed in the reply
+    uint64_t program_id;        // RUN: id returned by LOAD
+    uint64_t step_budget;       // RUN: maximum cycles to execute
+} BabydRequest;
+
+// Initial data for a RUN: one store word overwritten after the program is loaded
+typedef struct {
+    uint32_t address;           // Store address (reduced modulo the store size)
+    uint32_t value;             // Word value, bit j = store column j
+} BabydPoke;
+
+// Reply header; a successful RUN is followed by count final store words
+typedef struct {
+    uint32_t magic;             // BABYD_MAGIC
+    uint16_t status;            // BabydStatus
+    uint16_t count;             // Store words following the header
+    uint32_t tag;               // Tag of the request this answers
+    int32_t accumulator;        // Final accumulator
+    uint64_t program_id;        // Program the request referred to (LOAD: the new id)
+    uint64_t cycles;            // Cycles executed
+    int32_t CI;                 // Final Control Instruction
+    uint32_t running;           // 1 when the step budget ran out before STP
+} BabydReply;
+
+#endif
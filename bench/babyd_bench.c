@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../babyd.h"
+#include "../engine.h"
+
+// Maximum number of --poke options
+#define MAX_POKES 64
+
+static unsigned char reply_buffer[65536];
+static size_t reply_have = 0, reply_used = 0;
+
+// Display program usage information
+void printDaemonBenchUsage(const char* programName) {
+    printf("Usage: %s [options] <program file>\n", programName);
+    printf("Options:\n");
+    printf("  --socket PATH     babyd socket (default %s)\n", BABYD_DEFAULT_SOCKET);
+    printf("  --mem 32|64       Store size in words (default 32)\n");
+    printf("  --requests N      RUN requests to send (default 100000)\n");
+    printf("  --depth N         Requests kept in flight (default 1)\n");
+    printf("  --budget N        Step budget per run (default 1000000)\n");
+    printf("  --poke ADDR=VAL   Initial data sent with every run (repeatable)\n");
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Write a whole buffer to the socket
+static int send_all(int fd, const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    while (length > 0) {
+        ssize_t n = write(fd, bytes, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        bytes += n;
+        length -= (size_t)n;
+    }
+    return 0;
+}
+
+// Read exactly length bytes, buffering whatever else has already arrived
+static int receive_exact(int fd, void* data, size_t length) {
+    unsigned char* bytes = data;
+    while (length > 0) {
+        if (reply_used == reply_have) {
+            ssize_t n = read(fd, reply_buffer, sizeof(reply_buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return -1;
+            reply_have = (size_t)n;
+            reply_used = 0;
+        }
+        size_t chunk = reply_have - reply_used < length ? reply_have - reply_used : length;
+        memcpy(bytes, reply_buffer + reply_used, chunk);
+        reply_used += chunk;
+        bytes += chunk;
+        length -= chunk;
+    }
+    return 0;
+}
+
+// Read one reply header and its store words
+static int receive_reply(int fd, BabydReply* reply, uint32_t* words) {
+    if (receive_exact(fd, reply, sizeof(*reply)) < 0 || reply->magic != BABYD_MAGIC ||
+        reply->count > BABYD_MAX_WORDS) {
+        return -1;
+    }
+    return receive_exact(fd, words, reply->count * sizeof(uint32_t));
+}
+
+int main(int argc, char* argv[]) {
+    const char* socket_path = BABYD_DEFAULT_SOCKET;
+    const char* program_file = NULL;
+    int memory_size = 32;
+    long request_count = 100000;
+    long depth = 1;
+    unsigned long long budget = 1000000;
+    BabydPoke pokes[MAX_POKES];
+    int poke_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (strcmp(argv[i], "--mem") == 0 && i + 1 < argc) {
+            memory_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+            request_count = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depth = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budget = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--poke") == 0 && i + 1 < argc && poke_count < MAX_POKES) {
+            int value;
+            if (sscanf(argv[++i], "%u=%d", &pokes[poke_count].address, &value) != 2) {
+                printDaemonBenchUsage(argv[0]);
+                return 1;
+            }
+            pokes[poke_count++].value = (uint32_t)value;
+        } else if (argv[i][0] != '-' && !program_file) {
+            program_file = argv[i];
+        } else {
+            printDaemonBenchUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (!program_file || (memory_size != 32 && memory_size != 64) || request_count <= 0 || depth <= 0) {
+        printDaemonBenchUsage(argv[0]);
+        return 1;
+    }
+
+    // Pack the program with the simulator's own loader
+    BabyComputer computer;
+    PackedMachine image;
+    initialize_computer(&computer, memory_size);
+    computer.trace = LOG_OFF;
+    if (load_program(&computer, program_file) != 0) return 1;
+    engine_from_computer(&image, &computer);
+    free_computer(&computer);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        printf("Error: Unable to connect to '%s': %s\n", socket_path, strerror(errno));
+        return 1;
+    }
+
+    // Load the program once; every run refers to it by id
+    BabydRequest request;
+    BabydReply reply;
+    uint32_t words[BABYD_MAX_WORDS];
+    memset(&request, 0, sizeof(request));
+    request.magic = BABYD_MAGIC;
+    request.type = BABYD_LOAD;
+    request.count = (uint16_t)memory_size;
+    request.memory_size = (uint32_t)memory_size;
+    if (send_all(fd, &request, sizeof(request)) < 0 ||
+        send_all(fd, image.words, memory_size * sizeof(uint32_t)) < 0 ||
+        receive_reply(fd, &reply, words) < 0 || reply.status != BABYD_OK) {
+        printf("Error: babyd rejected the program\n");
+        return 1;
+    }
+    uint64_t program_id = reply.program_id;
+    printf("Program id %016llx\n", (unsigned long long)program_id);
+
+    // Every request is a header followed by the same pokes
+    size_t request_size = sizeof(request) + poke_count * sizeof(BabydPoke);
+    unsigned char* batch = malloc(request_size * depth);
+    double* sent_at = malloc(request_count * sizeof(double));
+    double* latency = malloc(request_count * sizeof(double));
+    request.type = BABYD_RUN;
+    request.count = (uint16_t)poke_count;
+    request.program_id = program_id;
+    request.step_budget = budget;
+
+    long sent = 0, received = 0;
+    double start = now_seconds();
+    while (received < request_count) {
+        // Top the pipeline up to depth outstanding requests
+        size_t length = 0;
+        while (sent < request_count && sent - received < depth) {
+            request.tag = (uint32_t)sent;
+            memcpy(batch + length, &request, sizeof(request));
+            memcpy(batch + length + sizeof(request), pokes, poke_count * sizeof(BabydPoke));
+            length += request_size;
+            sent++;
+        }
+        if (length > 0) {
+            double t = now_seconds();
+            for (long i = sent - (long)(length / request_size); i < sent; i++) sent_at[i] = t;
+            if (send_all(fd, batch, length) < 0) {
+                printf("Error: Connection to babyd lost\n");
+                return 1;
+            }
+        }
+
+        if (receive_reply(fd, &reply, words) < 0 || reply.status != BABYD_OK ||
+            reply.tag != (uint32_t)received) {
+            printf("Error: Bad reply to request %ld\n", received);
+            return 1;
+        }
+        latency[received] = now_seconds() - sent_at[received];
+        if (received == 0) {
+            printf("First run: A = %d, CI = %d, %llu cycles, %s\n", reply.accumulator, reply.CI,
+                   (unsigned long long)reply.cycles, reply.running ? "budget exhausted" : "stopped");
+        }
+        received++;
+    }
+    double elapsed = now_seconds() - start;
+
+    qsort(latency, request_count, sizeof(double), compare_doubles);
+    printf("%ld requests, depth %ld: %.0f requests/s\n", request_count, depth, request_count / elapsed);
+    printf("latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           latency[request_count / 2] * 1e6, latency[request_count * 99 / 100] * 1e6,
+           latency[request_count - 1] * 1e6);
+
+    close(fd);
+    free(batch);
+    free(sent_at);
+    free(latency);
+    return 0;
+}
@@ -0,0 +1,607 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../assembler.h"
+#include "../simulator.h"
+#include "../smp.h"
+#include "../loop.h"
+
+// Store size used by every workload
+#define BENCH_MEMORY 64
+// Maximum number of metrics in one run or baseline
+#define MAX_METRICS 32
+
+// Start offsets of the "count" loop checked by the loop acceleration pass
+#define COUNT_PHASES 8
+
+// Shared counters of the "lock" workload (fixed by its layout)
+#define LOCK_COUNT_WORD 31
+#define LOCK_DONE_WORD 32
+
+// Result of one measured metric
+typedef struct {
+    char name[64];              // Workload and metric, e.g. "loop.run"
+    const char* unit;           // Unit of mean and half-width
+    int higher_is_better;       // Throughputs regress downwards, times upwards
+    double mean;                // Sample mean
+    double ci95;                // Half-width of the 95% confidence interval
+} Metric;
+
+// Generated workload: assembly source and its machine code on disk
+typedef struct {
+    const char* name;           // Workload name
+    char source[64];            // Temporary assembly file
+    char program[64];           // Temporary machine code file
+} Workload;
+
+static Metric metrics[MAX_METRICS];
+static int metric_count = 0;
+static int saved_stdout = -1;
+
+// Two-sided 95% Student t values for 1..30 degrees of freedom
+static const double t95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The assembler and loader report progress on stdout; hide it while timing
+static void silence_stdout(void) {
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+}
+
+static void restore_stdout(void) {
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+}
+
+// Record mean and confidence interval of a set of samples
+static void add_metric(const char* workload, const char* what, const char* unit,
+                       int higher_is_better, const double* samples, int n) {
+    Metric* m = &metrics[metric_count++];
+    double sum = 0, var = 0;
+    for (int i = 0; i < n; i++) sum += samples[i];
+    m->mean = sum / n;
+    for (int i = 0; i < n; i++) var += (samples[i] - m->mean) * (samples[i] - m->mean);
+    double sd = n > 1 ? sqrt(var / (n - 1)) : 0;
+    double t = n - 1 <= 0 ? 0 : n - 1 <= 30 ? t95[n - 2] : 1.960;
+    m->ci95 = t * sd / sqrt(n);
+    snprintf(m->name, sizeof(m->name), "%s.%s", workload, what);
+    m->unit = unit;
+    m->higher_is_better = higher_is_better;
+    printf("%-18s %14.4g +/- %-10.3g %-9s (%.1f%%)\n", m->name, m->mean, m->ci95, unit,
+           m->mean != 0 ? 100 * m->ci95 / m->mean : 0);
+}
+
+// Write generated text to a temporary file
+static int write_temp(const char* text, char* path, size_t size, const char* suffix) {
+    snprintf(path, size, "/tmp/baby-bench-XXXXXX%s", suffix);
+    int fd = mkstemps(path, (int)strlen(suffix));
+    if (fd < 0) return -1;
+    size_t len = strlen(text);
+    int ok = write(fd, text, len) == (ssize_t)len;
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+// Counted loop skeleton. The Baby has no conditional jump, so the exit is
+// computed: flag = (C + 2^24 - 1) >> 24 is 1 while C > 0, and the loop
+// stores EXIT + flag * (LOOP - EXIT) into SLOT, which then runs as a JMP.
+static void emit_loop(FILE* out, long iterations, const char* init, const char* body, const char* data) {
+    fprintf(out, "          VAR 0\n");
+    fprintf(out, "          LDN EXITJ\n");
+    fprintf(out, "          ADD LOOPJ\n");
+    fprintf(out, "          STO DELTA\n");
+    fputs(init, out);
+    fprintf(out, "LOOP:     LDN C\n");
+    fprintf(out, "          ADD ONE\n");
+    fprintf(out, "          STO T\n");
+    fprintf(out, "          LDN T\n");
+    fprintf(out, "          STO C\n");
+    fputs(body, out);
+    fprintf(out, "          LDN T\n");
+    fprintf(out, "          ADD BIAS\n");
+    fprintf(out, "          SHR K\n");
+    fprintf(out, "          MUL DELTA\n");
+    fprintf(out, "          ADD EXITJ\n");
+    fprintf(out, "          STO SLOT\n");
+    fprintf(out, "SLOT:     VAR 0\n");
+    fprintf(out, "EXIT:     STP\n");
+    fprintf(out, "C:        VAR %ld\n", iterations);
+    fprintf(out, "ONE:      VAR 1\n");
+    fprintf(out, "T:        VAR 0\n");
+    fprintf(out, "BIAS:     VAR 16777215\n");
+    fprintf(out, "K:        VAR 24\n");
+    fprintf(out, "DELTA:    VAR 0\n");
+    fprintf(out, "EXITJ:    JMP EXIT\n");
+    fprintf(out, "LOOPJ:    JMP LOOP\n");
+    fputs(data, out);
+}
+
+// Generate the assembly source of a named workload
+static char* generate_workload(const char* name, long iterations) {
+    char* text = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&text, &size);
+
+    if (strcmp(name, "loop") == 0) {
+        // Bare decrement-and-test loop
+        emit_loop(out, iterations, "", "", "");
+    } else if (strcmp(name, "muldiv") == 0) {
+        // Multiplication by repeated addition plus the extended MUL/DIV
+        emit_loop(out, iterations, "",
+                  "          LDN P\n"
+                  "          SUB X\n"
+                  "          STO T2\n"
+                  "          LDN T2\n"
+                  "          STO P\n"
+                  "          LDN X\n"
+                  "          MUL Y\n"
+                  "          DIV Z\n"
+                  "          STO Q\n",
+                  "P:        VAR 0\n"
+                  "X:        VAR 7\n"
+                  "Y:        VAR 12345\n"
+                  "Z:        VAR 5\n"
+                  "Q:        VAR 0\n"
+                  "T2:       VAR 0\n");
+    } else if (strcmp(name, "selfmod") == 0) {
+        // Rewrites an instruction in the loop body every iteration
+        emit_loop(out, iterations,
+                  "          LDN IA\n"
+                  "          STO T3\n"
+                  "          LDN T3\n"
+                  "          XOR IB\n"
+                  "          STO TOGGLE\n",
+                  "          LDN PATCH\n"
+                  "          STO T3\n"
+                  "          LDN T3\n"
+                  "          XOR TOGGLE\n"
+                  "          STO PATCH\n"
+                  "PATCH:    ADD D1\n",
+                  "IA:       ADD D1\n"
+                  "IB:       ADD D2\n"
+                  "TOGGLE:   VAR 0\n"
+                  "T3:       VAR 0\n"
+                  "D1:       VAR 3\n"
+                  "D2:       VAR 5\n");
+    } else if (strcmp(name, "bigmem") == 0) {
+        // Touches most of a 64-word store every iteration
+        char body[1024] = "          LDN ZERO\n";
+        char data[1024] = "ZERO:     VAR 0\n";
+        char line[64];
+        for (int i = 1; i <= 12; i++) {
+            snprintf(line, sizeof(line), "          ADD D%d\n", i);
+            strcat(body, line);
+            snprintf(line, sizeof(line), "D%d:%*sVAR %d\n", i, i < 10 ? 7 : 6, "", i * 11);
+            strcat(data, line);
+        }
+        for (int i = 1; i <= 3; i++) {
+            snprintf(line, sizeof(line), "          STO S%d\n", i);
+            strcat(body, line);
+            snprintf(line, sizeof(line), "S%d:       VAR 0\n", i);
+            strcat(data, line);
+        }
+        emit_loop(out, iterations, "", body, data);
+    } else if (strncmp(name, "count", 5) == 0) {
+        // Eight-instruction counter loop leaving through TAS, for loop acceleration.
+        // "countN" puts N CMPs before it, so the loop is entered at another phase
+        // relative to the cycle counts at which the accelerator probes.
+        fprintf(out, "          VAR 0\n");
+        for (int i = atoi(name + 5); i > 0; i--) {
+            fprintf(out, "          CMP\n");
+        }
+        fprintf(out, "LOOP:     LDN C\n");
+        fprintf(out, "          ADD ONE\n");
+        fprintf(out, "          STO T\n");
+        fprintf(out, "          LDN T\n");
+        fprintf(out, "          STO C\n");
+        fprintf(out, "          STO F\n");
+        fprintf(out, "          TAS F\n");
+        fprintf(out, "          JMP LOOP\n");
+        fprintf(out, "          STP\n");
+        fprintf(out, "C:        VAR %ld\n", iterations);
+        fprintf(out, "ONE:      VAR 1\n");
+        fprintf(out, "T:        VAR 0\n");
+        fprintf(out, "F:        VAR 0\n");
+    } else if (strcmp(name, "spin") == 0) {
+        // SMP, no contention: read-only arithmetic on shared data that never stops
+        fprintf(out, "          VAR 0\n");
+        fprintf(out, "LOOP:     LDN X\n");
+        fprintf(out, "          MUL Y\n");
+        fprintf(out, "          ADD Z\n");
+        fprintf(out, "          XOR Y\n");
+        fprintf(out, "          SHR K\n");
+        fprintf(out, "          JMP LOOP\n");
+        fprintf(out, "X:        VAR 12345\n");
+        fprintf(out, "Y:        VAR 7\n");
+        fprintf(out, "Z:        VAR 3\n");
+        fprintf(out, "K:        VAR 2\n");
+    } else if (strcmp(name, "lock") == 0) {
+        // SMP, full contention: CPUs take work items from a shared count under a
+        // TAS spinlock until it runs out. The exit jump is computed and stored
+        // while the lock is held; both targets release it. Every acquisition
+        // moves one unit from C to DONE, so C + DONE stays constant.
+        fprintf(out, "          VAR 0\n");
+        fprintf(out, "          LDN EXITJ\n");
+        fprintf(out, "          ADD AGAINJ\n");
+        fprintf(out, "          STO DELTA\n");
+        fprintf(out, "SPIN:     TAS LOCK\n");
+        fprintf(out, "          JMP SPIN\n");
+        fprintf(out, "          LDN C\n");
+        fprintf(out, "          ADD ONE\n");
+        fprintf(out, "          STO T\n");
+        fprintf(out, "          LDN T\n");
+        fprintf(out, "          STO C\n");
+        fprintf(out, "          LDN DONE\n");
+        fprintf(out, "          SUB ONE\n");
+        fprintf(out, "          STO T\n");
+        fprintf(out, "          LDN T\n");
+        fprintf(out, "          STO DONE\n");
+        fprintf(out, "          LDN C\n");
+        fprintf(out, "          STO T\n");
+        fprintf(out, "          LDN T\n");
+        fprintf(out, "          ADD BIAS\n");
+        fprintf(out, "          SHR K\n");
+        fprintf(out, "          MUL DELTA\n");
+        fprintf(out, "          ADD EXITJ\n");
+        fprintf(out, "          STO SLOT\n");
+        fprintf(out, "SLOT:     VAR 0\n");
+        fprintf(out, "EXIT:     LDN ZERO\n");
+        fprintf(out, "          STO LOCK\n");
+        fprintf(out, "          STP\n");
+        fprintf(out, "AGAIN:    LDN ZERO\n");
+        fprintf(out, "          STO LOCK\n");
+        fprintf(out, "          JMP SPIN\n");
+        fprintf(out, "C:        VAR %ld\n", iterations);  // LOCK_COUNT_WORD
+        fprintf(out, "DONE:     VAR 0\n");                // LOCK_DONE_WORD
+        fprintf(out, "LOCK:     VAR 0\n");
+        fprintf(out, "ONE:      VAR 1\n");
+        fprintf(out, "ZERO:     VAR 0\n");
+        fprintf(out, "T:        VAR 0\n");
+        fprintf(out, "BIAS:     VAR 16777215\n");
+        fprintf(out, "K:        VAR 24\n");
+        fprintf(out, "DELTA:    VAR 0\n");
+        fprintf(out, "EXITJ:    JMP EXIT\n");
+        fprintf(out, "AGAINJ:   JMP AGAIN\n");
+    } else if (strcmp(name, "source") == 0) {
+        // Long source for assembler throughput: labels, comments and blank lines
+        fprintf(out, "; Generated assembler benchmark\n");
+        fprintf(out, "          VAR 0\n");
+        for (int i = 1; i < 32; i++) {
+            fprintf(out, "L%d:%*sVAR %d   ; data word\n", i, i < 10 ? 7 : 6, "", i * 3);
+        }
+        static const char* ops[] = { "LDN", "SUB", "STO", "ADD", "MUL", "DIV", "AND", "XOR" };
+        for (long i = 0; i < iterations; i++) {
+            if (i % 16 == 0) fprintf(out, "\n; block %ld\n", i / 16);
+            fprintf(out, "          %s L%ld   ; operation %ld\n", ops[i % 8], 1 + i % 31, i);
+        }
+        fprintf(out, "          STP\n");
+    }
+
+    fclose(out);
+    return text;
+}
+
+// Assemble a workload into temporary source and program files
+static int prepare_workload(Workload* w, long iterations) {
+    char* text = generate_workload(w->name, iterations);
+    int status = write_temp(text, w->source, sizeof(w->source), ".txt");
+    free(text);
+    if (status == 0) {
+        snprintf(w->program, sizeof(w->program), "%s", w->source);
+        strcpy(w->program + strlen(w->program) - 4, ".bin");
+        silence_stdout();
+        status = assemble(w->source, w->program, LOG_OFF);
+        restore_stdout();
+    }
+    if (status != 0) {
+        printf("Error: Unable to prepare workload '%s'\n", w->name);
+    }
+    return status;
+}
+
+// Simulator run loop throughput in instructions per second
+static void bench_run(Workload* w, int reps) {
+    double samples[64];
+    for (int r = 0; r < reps; r++) {
+        BabyComputer computer;
+        long long step = 0;
+        initialize_computer(&computer, BENCH_MEMORY);
+        computer.trace = LOG_OFF;
+        silence_stdout();
+        load_program(&computer, w->program);
+        restore_stdout();
+
+        double start = now_seconds();
+        while (computer.running) {
+            step_computer(&computer, &step);
+        }
+        samples[r] = step / (now_seconds() - start);
+        free_computer(&computer);
+    }
+    add_metric(w->name, "run", "instr/s", 1, samples, reps);
+}
+
+// load_program latency in microseconds
+static void bench_load(Workload* w, int reps) {
+    double samples[64];
+    const int loads = 2000;
+    BabyComputer computer;
+    initialize_computer(&computer, BENCH_MEMORY);
+    for (int r = 0; r < reps; r++) {
+        silence_stdout();
+        double start = now_seconds();
+        for (int i = 0; i < loads; i++) {
+            load_program(&computer, w->program);
+        }
+        double elapsed = now_seconds() - start;
+        restore_stdout();
+        samples[r] = elapsed / loads * 1e6;
+    }
+    free_computer(&computer);
+    add_metric(w->name, "load", "us", 0, samples, reps);
+}
+
+// assemble() throughput in source lines per second
+static void bench_assemble(Workload* w, int reps, long lines) {
+    double samples[64];
+    for (int r = 0; r < reps; r++) {
+        silence_stdout();
+        double start = now_seconds();
+        assemble(w->source, "/dev/null", LOG_OFF);
+        double elapsed = now_seconds() - start;
+        restore_stdout();
+        samples[r] = lines / elapsed;
+    }
+    add_metric(w->name, "assemble", "lines/s", 1, samples, reps);
+}
+
+// Load a workload into a fresh SMP machine
+static void load_smp(SmpMachine* smp, Workload* w, int cpus) {
+    BabyComputer computer;
+    PackedMachine image;
+    initialize_computer(&computer, BENCH_MEMORY);
+    computer.trace = LOG_OFF;
+    silence_stdout();
+    load_program(&computer, w->program);
+    restore_stdout();
+    engine_from_computer(&image, &computer);
+    free_computer(&computer);
+    smp_init(smp, &image, cpus);
+}
+
+// SMP scaling: aggregate instructions/sec for 1, 2, 4, ... CPUs sharing one store.
+// Host-dependent, so reported as a table rather than baseline metrics.
+static int bench_smp(Workload* spin, Workload* lock, long iterations) {
+    static SmpMachine smp;
+    int failures = 0;
+    printf("\n=== SMP scaling (threaded) ===\n");
+    printf("%-6s %5s %16s %9s\n", "work", "cpus", "instr/s", "speedup");
+    for (int pass = 0; pass < 2; pass++) {
+        Workload* w = pass == 0 ? spin : lock;
+        double single = 0;
+        for (int cpus = 1; cpus <= SMP_MAX_CPUS; cpus *= 2) {
+            load_smp(&smp, w, cpus);
+            long long cycles = 0;
+            double start = now_seconds();
+            smp_run_threads(&smp, pass == 0 ? iterations * 60 : LLONG_MAX);
+            double elapsed = now_seconds() - start;
+            for (int i = 0; i < cpus; i++) cycles += smp.cpus[i].cycles;
+            double rate = cycles / elapsed;
+            if (cpus == 1) single = rate;
+            printf("%-6s %5d %16.4g %8.2fx", w->name, cpus, rate, rate / single);
+            if (pass == 1) {
+                // Mutual exclusion holds iff no update of C or DONE was lost
+                int32_t count = (int32_t)smp.words[LOCK_COUNT_WORD];
+                int32_t done = (int32_t)smp.words[LOCK_DONE_WORD];
+                int ok = count + done == iterations;
+                printf("  C %d + DONE %d %s", count, done, ok ? "ok" : "LOST UPDATES");
+                failures += !ok;
+            }
+            printf("\n");
+        }
+    }
+
+    // Round-robin runs must reproduce the same final store exactly
+    uint32_t first[BENCH_MEMORY];
+    load_smp(&smp, lock, 4);
+    smp_run_round_robin(&smp, LLONG_MAX, 3);
+    memcpy(first, smp.words, sizeof(first));
+    load_smp(&smp, lock, 4);
+    smp_run_round_robin(&smp, LLONG_MAX, 3);
+    int same = memcmp(first, smp.words, sizeof(first)) == 0;
+    printf("round-robin (4 CPUs, quantum 3): %s\n", same ? "deterministic" : "NOT DETERMINISTIC");
+    return failures + !same;
+}
+
+// Load a workload into a packed machine
+static void load_packed(PackedMachine* machine, Workload* w) {
+    BabyComputer computer;
+    initialize_computer(&computer, BENCH_MEMORY);
+    computer.trace = LOG_OFF;
+    silence_stdout();
+    load_program(&computer, w->program);
+    restore_stdout();
+    engine_from_computer(machine, &computer);
+    free_computer(&computer);
+}
+
+// Loop acceleration: the counter loop entered at every phase must be summarized
+// and end in exactly the state of a plain engine run. Returns the number of failures.
+static int bench_accelerate(long iterations) {
+    static PackedMachine plain, accelerated;
+    static char names[COUNT_PHASES][16];
+    int failures = 0;
+    printf("\n=== Loop acceleration ===\n");
+    printf("%-7s %8s %14s %12s\n", "work", "loops", "cycles", "host s");
+    for (int phase = 0; phase < COUNT_PHASES; phase++) {
+        snprintf(names[phase], sizeof(names[phase]), "count%d", phase);
+        Workload w = { .name = names[phase] };
+        if (prepare_workload(&w, iterations) != 0) return failures + 1;
+        load_packed(&plain, &w);
+        load_packed(&accelerated, &w);
+        unlink(w.source);
+        unlink(w.program);
+
+        LoopStats stats = {0};
+        engine_run(&plain, LLONG_MAX);
+        double start = now_seconds();
+        long long cycles = loop_run(&accelerated, LLONG_MAX, &stats);
+        double elapsed = now_seconds() - start;
+        int same = plain.cycles == accelerated.cycles && plain.beats == accelerated.beats &&
+                   plain.accumulator == accelerated.accumulator && plain.CI == accelerated.CI &&
+                   memcmp(plain.words, accelerated.words, sizeof(plain.words)) == 0;
+        int ok = same && stats.loops > 0;
+        printf("%-7s %8lld %14lld %12.6f  %s\n", w.name, stats.loops, cycles, elapsed,
+               !same ? "STATE DIFFERS" : ok ? "ok" : "NOT SUMMARIZED");
+        failures += !ok;
+    }
+    return failures;
+}
+
+// Compare against a stored baseline; returns the number of regressions
+static int compare_baseline(const char* path, double threshold) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        printf("Error: Unable to open baseline '%s'\n", path);
+        return -1;
+    }
+
+    char line[256], name[64];
+    double mean;
+    int regressions = 0;
+    printf("\n=== Baseline comparison (threshold %.1f%%) ===\n", threshold);
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#' || sscanf(line, "%63s %lf", name, &mean) != 2) continue;
+        for (int i = 0; i < metric_count; i++) {
+            if (strcmp(metrics[i].name, name) != 0) continue;
+            double change = 100 * (metrics[i].mean - mean) / mean;
+            int regressed = metrics[i].higher_is_better ? change < -threshold : change > threshold;
+            printf("%-18s %+7.1f%% %s\n", name, change, regressed ? "REGRESSION" : "ok");
+            regressions += regressed;
+        }
+    }
+    fclose(fp);
+    return regressions;
+}
+
+static int save_baseline(const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        printf("Error: Unable to write baseline '%s'\n", path);
+        return -1;
+    }
+    fprintf(fp, "# metric mean unit\n");
+    for (int i = 0; i < metric_count; i++) {
+        fprintf(fp, "%s %.6g %s\n", metrics[i].name, metrics[i].mean, metrics[i].unit);
+    }
+    fclose(fp);
+    printf("Baseline written to '%s'\n", path);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    int reps = 10;
+    long iterations = 100000;
+    long source_lines = 20000;
+    double threshold = 5.0;
+    const char* baseline = NULL;
+    const char* save = NULL;
+    int smp = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            reps = 5;
+            iterations = 10000;
+            source_lines = 2000;
+        } else if (strcmp(argv[i], "--smp") == 0) {
+            smp = 1;
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc) {
+            save = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--emit") == 0 && i + 2 < argc) {
+            // Print a workload's source so it can be run or inspected by hand
+            char* text = generate_workload(argv[i + 1], atol(argv[i + 2]));
+            fputs(text, stdout);
+            free(text);
+            return 0;
+        } else {
+            reps = 0;
+            break;
+        }
+    }
+    if (reps < 2 || reps > 64) {
+        printf("Usage: %s [--reps 2-64] [--quick] [--smp] [--baseline file] [--save-baseline file] [--threshold pct]\n", argv[0]);
+        printf("       %s --emit <loop|muldiv|selfmod|bigmem|count|spin|lock|source> <iterations>\n", argv[0]);
+        return 1;
+    }
+
+    Workload workloads[] = { { .name = "loop" }, { .name = "muldiv" }, { .name = "selfmod" }, { .name = "bigmem" } };
+    Workload source = { .name = "source" };
+    int count = sizeof(workloads) / sizeof(workloads[0]);
+
+    printf("=== Manchester Baby benchmark (%d samples, 95%% confidence) ===\n", reps);
+    int status = 0;
+    for (int i = 0; i < count && status == 0; i++) {
+        status = prepare_workload(&workloads[i], iterations);
+        if (status == 0) {
+            bench_run(&workloads[i], reps);
+            bench_load(&workloads[i], reps);
+        }
+    }
+    if (status == 0 && (status = prepare_workload(&source, source_lines)) == 0) {
+        bench_assemble(&source, reps, source_lines);
+    }
+    if (status == 0) {
+        status = bench_accelerate(iterations);
+    }
+
+    if (status == 0 && smp) {
+        Workload spin = { .name = "spin" }, lock = { .name = "lock" };
+        if ((status = prepare_workload(&spin, iterations)) == 0 &&
+            (status = prepare_workload(&lock, iterations)) == 0) {
+            status = bench_smp(&spin, &lock, iterations);
+        }
+        unlink(spin.source);
+        unlink(spin.program);
+        unlink(lock.source);
+        unlink(lock.program);
+    }
+
+    for (int i = 0; i < count; i++) {
+        unlink(workloads[i].source);
+        unlink(workloads[i].program);
+    }
+    unlink(source.source);
+    unlink(source.program);
+    if (status != 0) return 1;
+
+    if (save && save_baseline(save) < 0) return 1;
+    if (baseline) {
+        int regressions = compare_baseline(baseline, threshold);
+        if (regressions != 0) return 1;
+    }
+    return 0;
+}
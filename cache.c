@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+// Everything a run's result depends on, hashed to form its key
+typedef struct {
+    int32_t memory_size;
+    int32_t accumulator;
+    int32_t CI;
+    uint32_t PI;
+    int32_t running;
+    int32_t index;
+    long long budget;           // Step budget, 0 for "until STP"
+    long long beats;            // Machine time already accumulated
+    unsigned char costs[ENGINE_OPCODES];  // Timing model the beats were charged with
+    uint32_t words[ENGINE_MAX_WORDS];
+} KeyMaterial;
+
+// Open or create a result cache file and map it; entries only applies to new files
+int cache_open(ResultCache* cache, const char* path, int entries) {
+    memset(cache, 0, sizeof(*cache));
+    cache->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (cache->fd < 0) {
+        printf("Error: Unable to open result cache '%s'\n", path);
+        return -1;
+    }
+
+    flock(cache->fd, LOCK_EX);
+    struct stat st;
+    CacheHeader header;
+    int created = 0;
+    fstat(cache->fd, &st);
+    if (st.st_size == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+        header.record_size = sizeof(CacheRecord);
+        header.sets = 1;
+        while (header.sets * CACHE_WAYS < (uint32_t)entries) header.sets <<= 1;
+        cache->mapped_size = sizeof(CacheHeader) + (size_t)header.sets * CACHE_WAYS * sizeof(CacheRecord);
+        if (ftruncate(cache->fd, (off_t)cache->mapped_size) != 0) {
+            printf("Error: Unable to size result cache '%s'\n", path);
+            flock(cache->fd, LOCK_UN);
+            close(cache->fd);
+            return -1;
+        }
+        created = 1;
+    } else if (pread(cache->fd, &header, sizeof(header), 0) != sizeof(header) ||
+               memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+               header.record_size != sizeof(CacheRecord) ||
+               header.sets == 0 || (header.sets & (header.sets - 1)) != 0 ||
+               (size_t)st.st_size != sizeof(CacheHeader) + (size_t)header.sets * CACHE_WAYS * sizeof(CacheRecord)) {
+        printf("Error: '%s' is not a result cache file\n", path);
+        flock(cache->fd, LOCK_UN);
+        close(cache->fd);
+        return -1;
+    } else {
+        cache->mapped_size = (size_t)st.st_size;
+    }
+
+    void* map = mmap(NULL, cache->mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, cache->fd, 0);
+    if (map == MAP_FAILED) {
+        printf("Error: Unable to map result cache '%s'\n", path);
+        flock(cache->fd, LOCK_UN);
+        close(cache->fd);
+        return -1;
+    }
+    cache->header = map;
+    cache->records = (CacheRecord*)((char*)map + sizeof(CacheHeader));
+    if (created) {
+        memcpy(cache->header, &header, sizeof(header));
+    }
+    flock(cache->fd, LOCK_UN);
+    return 0;
+}
+
+// Unmap and close the cache file
+void cache_close(ResultCache* cache) {
+    if (cache->header) {
+        munmap(cache->header, cache->mapped_size);
+        close(cache->fd);
+        cache->header = NULL;
+    }
+}
+
+// Hash the initial machine and step budget of a run
+CacheKey cache_key(const PackedMachine* initial, long long budget) {
+    KeyMaterial material;
+    memset(&material, 0, sizeof(material));
+    material.memory_size = initial->memory_size;
+    material.accumulator = initial->accumulator;
+    material.CI = initial->CI;
+    material.PI = initial->PI;
+    material.running = initial->running;
+    material.index = initial->index;
+    material.budget = budget;
+    material.beats = initial->beats;
+    memcpy(material.costs, engine_beats, sizeof(material.costs));
+    memcpy(material.words, initial->words, initial->memory_size * sizeof(uint32_t));
+
+    CacheKey key;
+    key.hash = engine_hash(&material, sizeof(material), 0x42414259ULL);
+    key.check = engine_hash(&material, sizeof(material), 0x52455355ULL);
+    if (key.hash == 0) key.hash = 1;  // 0 marks an empty record
+    return key;
+}
+
+// Set of records a key can live in
+static CacheRecord* cache_set(ResultCache* cache, CacheKey key) {
+    return &cache->records[(key.hash & (cache->header->sets - 1)) * CACHE_WAYS];
+}
+
+// Copy a cached result into machine; returns 1 on a hit, 0 on a miss
+int cache_lookup(ResultCache* cache, CacheKey key, PackedMachine* result) {
+    int hit = 0;
+    flock(cache->fd, LOCK_EX);
+    CacheRecord* set = cache_set(cache, key);
+    for (int w = 0; w < CACHE_WAYS; w++) {
+        CacheRecord* record = &set[w];
+        if (record->hash != key.hash || record->check != key.check) continue;
+        // A corrupt or foreign record must not overflow the machine's store
+        if (record->memory_size < 1 || record->memory_size > ENGINE_MAX_WORDS) continue;
+
+        result->memory_size = record->memory_size;
+        memcpy(result->words, record->words, record->memory_size * sizeof(uint32_t));
+        for (int a = 0; a < record->memory_size; a++) {
+            result->decoded[a] = engine_decode(result->words[a], a, record->memory_size);
+        }
+        result->accumulator = record->accumulator;
+        result->CI = record->CI;
+        result->PI = record->PI;
+        result->index = record->index;
+        result->running = record->running;
+        result->dirty = record->dirty;
+        result->cycles = record->cycles;
+        result->beats = record->beats;
+        record->last_used = ++cache->header->clock;
+        hit = 1;
+        break;
+    }
+    if (hit) {
+        cache->header->hits++;
+        cache->hits++;
+    } else {
+        cache->header->misses++;
+        cache->misses++;
+    }
+    flock(cache->fd, LOCK_UN);
+    return hit;
+}
+
+// Record the result of a run, evicting the least recently used record of its set
+void cache_store(ResultCache* cache, CacheKey key, const PackedMachine* result) {
+    flock(cache->fd, LOCK_EX);
+    CacheRecord* set = cache_set(cache, key);
+    CacheRecord* victim = &set[0];
+    for (int w = 0; w < CACHE_WAYS; w++) {
+        if (set[w].hash == 0 || (set[w].hash == key.hash && set[w].check == key.check)) {
+            victim = &set[w];
+            break;
+        }
+        if (set[w].last_used < victim->last_used) {
+            victim = &set[w];
+        }
+    }
+    if (victim->hash != 0 && (victim->hash != key.hash || victim->check != key.check)) {
+        cache->header->evictions++;
+        cache->evictions++;
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->check = key.check;
+    victim->dirty = result->dirty;
+    victim->cycles = result->cycles;
+    victim->beats = result->beats;
+    victim->memory_size = result->memory_size;
+    victim->accumulator = result->accumulator;
+    victim->CI = result->CI;
+    victim->PI = result->PI;
+    victim->index = result->index;
+    victim->running = result->running;
+    memcpy(victim->words, result->words, result->memory_size * sizeof(uint32_t));
+    victim->last_used = ++cache->header->clock;
+    victim->hash = key.hash;
+    flock(cache->fd, LOCK_UN);
+}
+
+// Print hit/miss statistics for this process and the cache's lifetime
+void cache_report(const ResultCache* cache) {
+    unsigned long long lookups = cache->hits + cache->misses;
+    unsigned long long lifetime = cache->header->hits + cache->header->misses;
+    printf("\n=== Result Cache ===\n");
+    printf("This run: %llu hits, %llu misses (%.1f%% hit rate), %llu evictions\n",
+           cache->hits, cache->misses, lookups ? 100.0 * cache->hits / lookups : 0.0, cache->evictions);
+    printf("Lifetime: %llu hits, %llu misses (%.1f%% hit rate), %llu evictions, %u records\n",
+           (unsigned long long)cache->header->hits, (unsigned long long)cache->header->misses,
+           lifetime ? 100.0 * cache->header->hits / lifetime : 0.0,
+           (unsigned long long)cache->header->evictions, cache->header->sets * CACHE_WAYS);
+}
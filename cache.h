@@ -0,0 +1,67 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include "engine.h"
+
+// Identifies a result cache file and its record layout
+#define CACHE_MAGIC "BABYRC4"
+// Records per set; a full set evicts its least recently used record
+#define CACHE_WAYS 8
+// Records in a newly created cache file unless --cache-entries says otherwise
+#define CACHE_DEFAULT_ENTRIES 16384
+
+// Content hash of everything a deterministic run depends on
+typedef struct {
+    uint64_t hash;              // Selects the set and identifies the run
+    uint64_t check;             // Independent hash guarding against collisions
+} CacheKey;
+
+// File header, followed by sets * CACHE_WAYS records
+typedef struct {
+    char magic[8];              // CACHE_MAGIC
+    uint32_t record_size;       // sizeof(CacheRecord) when the file was created
+    uint32_t sets;              // Number of sets (power of two)
+    uint64_t clock;             // Advances on every hit and insert
+    uint64_t hits;              // Lifetime hits
+    uint64_t misses;            // Lifetime misses
+    uint64_t evictions;         // Lifetime evictions
+} CacheHeader;
+
+// Final state of one run
+typedef struct {
+    uint64_t hash;              // Key hash, 0 for an empty record
+    uint64_t check;             // Key check hash
+    uint64_t last_used;         // Header clock at the last hit or insert
+    uint64_t dirty;             // Store words written by the run
+    long long cycles;           // Cycles executed
+    long long beats;            // Simulated machine time in beats
+    int32_t memory_size;        // Store size
+    int32_t accumulator;        // Final accumulator
+    int32_t CI;                 // Final Control Instruction
+    uint32_t PI;                // Last fetched word, in store bit order
+    int32_t index;              // Final index register
+    int32_t running;            // Stop reason: 0 after STP, 1 when the budget ran out
+    uint32_t words[ENGINE_MAX_WORDS];  // Final store
+} CacheRecord;
+
+// Open result cache: the whole file is mapped and used in place
+typedef struct {
+    int fd;                     // Cache file, locked around every access
+    CacheHeader* header;        // Mapped header
+    CacheRecord* records;       // Mapped records
+    size_t mapped_size;         // Bytes mapped
+    unsigned long long hits;    // Hits in this process
+    unsigned long long misses;  // Misses in this process
+    unsigned long long evictions;  // Evictions in this process
+} ResultCache;
+
+// Function declarations
+int cache_open(ResultCache* cache, const char* path, int entries);
+void cache_close(ResultCache* cache);
+CacheKey cache_key(const PackedMachine* initial, long long budget);
+int cache_lookup(ResultCache* cache, CacheKey key, PackedMachine* result);
+void cache_store(ResultCache* cache, CacheKey key, const PackedMachine* result);
+void cache_report(const ResultCache* cache);
+
+#endif
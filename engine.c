@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <string.h>
+#include "engine.h"
+
+// Beats per opcode. Every instruction takes the original four beats except the
+// extended MUL and DIV, costed as a bit-serial unit needing a beat per bit.
+#define B INSTRUCTION_BEATS
+unsigned char engine_beats[ENGINE_OPCODES] = {
+    B, B, B, B, B, B + 32, B, B,    // JMP ADD SUB OR  LDN DIV  CMP SHL
+    B, B + 32, B, B, B, B, B, B,    // JRP MUL SUB2 XOR STO AND STP SHR
+    B, B, B, B, B, B, B, B,         // TAS LDX, then unassigned extension opcodes
+    B, B, B, B, B, B, B, B
+};
+#undef B
+double engine_beat_us = BEAT_MICROSECONDS;
+
+// Mnemonic of an opcode, "???" for unassigned extension opcodes
+const char* engine_mnemonic(int opcode) {
+    static const char* const names[ENGINE_OPCODES] = {
+        [JMP] = "JMP", [JRP] = "JRP", [LDN] = "LDN", [STO] = "STO", [SUB] = "SUB", [SUB2] = "SUB2",
+        [CMP] = "CMP", [STP] = "STP", [ADD] = "ADD", [MUL] = "MUL", [DIV] = "DIV", [AND] = "AND",
+        [OR] = "OR", [XOR] = "XOR", [SHL] = "SHL", [SHR] = "SHR", [TAS] = "TAS", [LDX] = "LDX"
+    };
+    return opcode >= 0 && opcode < ENGINE_OPCODES && names[opcode] ? names[opcode] : "???";
+}
+
+// Override opcode costs from a list such as "MUL=40,DIV=70"; must run before
+// any program is decoded. Returns -1 on a malformed list.
+int engine_set_timing(const char* spec) {
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", spec);
+    for (char* item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        char name[16];
+        int beats, opcode = -1;
+        if (sscanf(item, "%15[^=]=%d", name, &beats) != 2 || beats < 0 || beats > 255) {
+            return -1;
+        }
+        for (int op = 0; op < ENGINE_OPCODES; op++) {
+            if (strcmp(engine_mnemonic(op), name) == 0) opcode = op;
+        }
+        if (opcode < 0) return -1;
+        engine_beats[opcode] = (unsigned char)beats;
+    }
+    return 0;
+}
+
+// Convert beats to seconds on the original machine
+double engine_simulated_seconds(long long beats) {
+    return beats * engine_beat_us / 1e6;
+}
+
+// Reverse the bit order of a word (store columns <-> the PI register layout)
+uint32_t engine_reverse_bits(uint32_t value) {
+    value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+    value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+    value = ((value >> 4) & 0x0F0F0F0Fu) | ((value & 0x0F0F0F0Fu) << 4);
+    value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+    return (value >> 16) | (value << 16);
+}
+
+// Fast 64-bit content hash: 8-byte lanes mixed with a multiply-xorshift step
+uint64_t engine_hash(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* bytes = data;
+    uint64_t hash = seed ^ (length * 0x9E3779B97F4A7C15ULL);
+    while (length >= 8) {
+        uint64_t lane;
+        memcpy(&lane, bytes, 8);
+        hash = (hash ^ lane) * 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 31;
+        bytes += 8;
+        length -= 8;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, bytes, length);
+    hash = (hash ^ tail) * 0x94D049BB133111EBULL;
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    return hash ^ (hash >> 32);
+}
+
+// Decode the word at store address the way decode() does, resolving the operand
+// to a store address as far as it can be without the run-time registers
+DecodedWord engine_decode(uint32_t word, int address, int memory_size) {
+    DecodedWord decoded;
+    decoded.opcode = (uint8_t)(((word >> 13) & 1) << 3 | ((word >> 14) & 1) << 2 |
+                               ((word >> 15) & 1) << 1 | ((word >> 16) & 1) |
+                               ((word >> 17) & 1) << 4);
+    decoded.beats = engine_beats[decoded.opcode];
+
+    uint32_t operand = word & 0x1FFF;
+    int mode = (word >> MODE_COLUMN) & 3;
+    if (mode == IMMEDIATE && !READS_OPERAND(decoded.opcode)) {
+        mode = DIRECT;
+    }
+    if (mode == RELATIVE) {
+        operand += (uint32_t)address;
+        mode = DIRECT;
+    }
+    decoded.mode = (uint8_t)(mode | ((word >> INDEX_COLUMN) & 1) * ENGINE_INDEXED);
+    decoded.address = (uint16_t)(mode == IMMEDIATE ? operand : operand % (uint32_t)memory_size);
+    return decoded;
+}
+
+// Decode a program image once; words past count are zero
+void engine_prepare(DecodedProgram* program, const uint32_t* words, int count, int memory_size) {
+    memset(program->words, 0, sizeof(program->words));
+    memcpy(program->words, words, (count < memory_size ? count : memory_size) * sizeof(uint32_t));
+    program->memory_size = memory_size;
+    for (int i = 0; i < memory_size; i++) {
+        program->decoded[i] = engine_decode(program->words[i], i, memory_size);
+    }
+    program->hash = engine_hash(program->words, memory_size * sizeof(uint32_t), (uint64_t)memory_size);
+}
+
+// Put a machine in the initial state of a decoded program
+void engine_reset(PackedMachine* machine, const DecodedProgram* program) {
+    machine->memory_size = program->memory_size;
+    memcpy(machine->words, program->words, program->memory_size * sizeof(uint32_t));
+    memcpy(machine->decoded, program->decoded, program->memory_size * sizeof(DecodedWord));
+    machine->accumulator = 0;
+    machine->CI = 0;
+    machine->PI = 0;
+    machine->index = 0;
+    machine->running = 1;
+    machine->dirty = 0;
+    machine->cycles = 0;
+    machine->beats = 0;
+}
+
+// Overwrite one store word before a run (initial data)
+void engine_poke(PackedMachine* machine, int address, uint32_t value) {
+    address %= machine->memory_size;
+    machine->words[address] = value;
+    machine->decoded[address] = engine_decode(value, address, machine->memory_size);
+}
+
+// Run up to budget cycles with the semantics of step_computer; returns the
+// number of cycles executed. Registers live in locals for the whole run.
+// Inlined into each caller so a NULL hook costs nothing in engine_run.
+static inline __attribute__((always_inline))
+long long run_machine(PackedMachine* machine, long long budget, EngineEdgeHook hook, void* context) {
+    uint32_t* words = machine->words;
+    DecodedWord* decoded = machine->decoded;
+    const int size = machine->memory_size;
+    uint32_t acc = (uint32_t)machine->accumulator;
+    uint32_t pi = machine->PI;
+    uint32_t index = (uint32_t)machine->index;
+    int ci = machine->CI;
+    int running = machine->running;
+    unsigned long long dirty = machine->dirty;
+    const long long skip_beats = engine_beats[CMP];
+    long long cycles = 0;
+    long long beats = 0;
+
+    while (running && cycles < budget) {
+        cycles++;
+        pi = words[ci];
+        if (hook) {
+            hook(context, ci, decoded[ci].opcode);
+        }
+        if (ci == 0) {
+            // Skip the initialization word, as execute() does
+            beats += skip_beats;
+            ci = 1;
+            continue;
+        }
+
+        DecodedWord instruction = decoded[ci];
+        beats += instruction.beats;
+        uint32_t address = instruction.address;
+        uint32_t value;
+        if (__builtin_expect(instruction.mode != DIRECT, 0)) {
+            address = engine_effective(instruction, index, words, size);
+            value = (instruction.mode & ENGINE_MODE_MASK) == IMMEDIATE ? address : words[address];
+        } else {
+            value = words[address];
+        }
+        switch (instruction.opcode) {
+            case JMP:
+                ci = (int)address;
+                continue;
+            case JRP:
+                ci += (int)address;
+                if (ci >= size) ci -= size;
+                continue;
+            case STO:
+                words[address] = acc;
+                decoded[address] = engine_decode(acc, (int)address, size);
+                dirty |= 1ULL << address;
+                break;
+            case CMP:
+                break;
+            case STP:
+                running = 0;
+                continue;
+            case TAS:
+                words[address] = 1;
+                decoded[address] = engine_decode(1, (int)address, size);
+                dirty |= 1ULL << address;
+                acc = value;
+                if (value == 0 && ++ci == size) ci = 0;
+                break;
+            case LDX:
+                index = value;
+                break;
+            default:
+                acc = engine_alu(instruction.opcode, acc, value);
+                break;
+        }
+        if (++ci == size) ci = 0;
+    }
+
+    machine->accumulator = (int32_t)acc;
+    machine->PI = pi;
+    machine->index = (int32_t)index;
+    machine->CI = ci;
+    machine->running = running;
+    machine->dirty = dirty;
+    machine->cycles += cycles;
+    machine->beats += beats;
+    return cycles;
+}
+
+// Run up to budget cycles; returns the number of cycles executed
+long long engine_run(PackedMachine* machine, long long budget) {
+    return run_machine(machine, budget, NULL, NULL);
+}
+
+// engine_run that reports every fetched instruction to hook before executing it
+long long engine_run_traced(PackedMachine* machine, long long budget, EngineEdgeHook hook, void* context) {
+    return run_machine(machine, budget, hook, context);
+}
+
+// Pack a reference machine's store and registers into the fast engine
+void engine_from_computer(PackedMachine* machine, const BabyComputer* computer) {
+    machine->memory_size = computer->memory_size;
+    for (int a = 0; a < computer->memory_size; a++) {
+        uint32_t word = 0;
+        for (int i = 0; i < WORD_SIZE; i++) {
+            word |= (uint32_t)(computer->store[a][i] & 1) << i;
+        }
+        machine->words[a] = word;
+        machine->decoded[a] = engine_decode(word, a, computer->memory_size);
+    }
+    machine->accumulator = computer->accumulator;
+    machine->CI = computer->CI;
+    machine->PI = engine_reverse_bits((uint32_t)computer->PI);
+    machine->index = computer->index_reg;
+    machine->running = computer->running;
+    machine->dirty = 0;
+    machine->cycles = 0;
+    machine->beats = computer->beats;
+}
+
+// Copy the fast engine's state back into a reference machine
+void engine_to_computer(const PackedMachine* machine, BabyComputer* computer) {
+    for (int a = 0; a < machine->memory_size; a++) {
+        uint32_t word = machine->words[a];
+        for (int i = 0; i < WORD_SIZE; i++) {
+            computer->store[a][i] = (word >> i) & 1;
+        }
+    }
+    computer->accumulator = machine->accumulator;
+    computer->CI = machine->CI;
+    computer->PI = (int)engine_reverse_bits(machine->PI);
+    computer->index_reg = machine->index;
+    computer->running = machine->running;
+    computer->beats = machine->beats;
+    computer->dirty |= machine->dirty;
+}
@@ -0,0 +1,117 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "simulator.h"
+
+// Largest store the packed engine holds
+#define ENGINE_MAX_WORDS 64
+// Opcodes including the extension set (bit 18)
+#define ENGINE_OPCODES 32
+
+// Timing model of the original machine: 36 digit periods of 10 us make a beat,
+// and a base instruction takes four beats (about 700 instructions a second)
+#define BEAT_MICROSECONDS 360.0
+#define INSTRUCTION_BEATS 4
+
+// Decoded addressing modes: RELATIVE is folded into the address when the word is
+// decoded, so at run time only indexed, INDIRECT and IMMEDIATE operands need work
+#define ENGINE_MODE_MASK 3
+#define ENGINE_INDEXED 4
+
+// One store word decoded ahead of time
+typedef struct {
+    uint8_t opcode;             // Opcode as numbered in OpCode (extension bit included)
+    uint8_t beats;              // Cost in beats from engine_beats, charged when executed
+    uint8_t mode;               // DIRECT, INDIRECT or IMMEDIATE, plus ENGINE_INDEXED; 0 is plain direct
+    uint16_t address;           // Effective address reduced modulo the store size (the raw operand if IMMEDIATE)
+} DecodedWord;
+
+// Called by engine_run_traced with the address and opcode of each fetched instruction
+typedef void (*EngineEdgeHook)(void* context, int CI, int opcode);
+
+// Program decoded once and copied into any number of machines
+typedef struct {
+    uint64_t hash;              // Content hash of the store size and image
+    int memory_size;            // Store size the program was decoded for
+    uint32_t words[ENGINE_MAX_WORDS];         // Initial store, bit j = store column j
+    DecodedWord decoded[ENGINE_MAX_WORDS];    // Every store word in decoded form
+} DecodedProgram;
+
+// Fast engine machine: one packed 32-bit value per store line plus its decoded
+// form, which STO keeps up to date so self-modifying code needs no invalidation
+typedef struct {
+    uint32_t words[ENGINE_MAX_WORDS];         // Store, bit j = store column j
+    DecodedWord decoded[ENGINE_MAX_WORDS];    // Decoded copy of words
+    int memory_size;            // Words in use
+    int32_t accumulator;        // Accumulator register
+    int CI;                     // Control Instruction (Program Counter)
+    uint32_t PI;                // Last fetched word, in store bit order
+    int32_t index;              // Index register X
+    int running;                // Cleared by STP
+    unsigned long long dirty;   // Bit i set when store word i was written
+    long long cycles;           // Cycles executed since the last reset
+    long long beats;            // Simulated machine time in beats
+} PackedMachine;
+
+// Beats charged per opcode (the CI == 0 skip costs as much as CMP), and beat length
+extern unsigned char engine_beats[ENGINE_OPCODES];
+extern double engine_beat_us;
+
+// Accumulator update of every instruction that only reads its operand word;
+// shared by all engines so the arithmetic edge cases are defined in one place
+static inline uint32_t engine_alu(int opcode, uint32_t acc, uint32_t value) {
+    switch (opcode) {
+        case LDN: return 0u - value;
+        case SUB:
+        case SUB2: return acc - value;
+        case ADD: return acc + value;
+        case MUL: return acc * value;
+        case DIV:
+            // Division by zero leaves A unchanged; by -1 it negates with wraparound
+            if (value == 0xFFFFFFFFu) return 0u - acc;
+            return value != 0 ? (uint32_t)((int32_t)acc / (int32_t)value) : acc;
+        case AND: return acc & value;
+        case OR: return acc | value;
+        case XOR: return acc ^ value;
+        case SHL: return value >= 32 ? 0 : acc << value;
+        case SHR: return (uint32_t)((int32_t)acc >> (value >= 32 ? 31 : value));
+        default: return acc;
+    }
+}
+
+// Effective address of a decoded instruction whose mode is not plain direct, or
+// its operand value if IMMEDIATE. Pointer words are read with acquire loads so
+// the SMP core can share this with the single-threaded engine.
+static inline uint32_t engine_effective(DecodedWord instruction, uint32_t index, const uint32_t* words, int size) {
+    uint32_t operand = instruction.address;
+    if (instruction.mode & ENGINE_INDEXED) {
+        operand += index;
+    }
+    switch (instruction.mode & ENGINE_MODE_MASK) {
+        case INDIRECT:
+            return (__atomic_load_n(&words[operand % (uint32_t)size], __ATOMIC_ACQUIRE) & 0x1FFF) % (uint32_t)size;
+        case IMMEDIATE:
+            return operand;
+        default:
+            return operand % (uint32_t)size;
+    }
+}
+
+// Function declarations
+const char* engine_mnemonic(int opcode);
+int engine_set_timing(const char* spec);
+double engine_simulated_seconds(long long beats);
+uint32_t engine_reverse_bits(uint32_t value);
+uint64_t engine_hash(const void* data, size_t length, uint64_t seed);
+DecodedWord engine_decode(uint32_t word, int address, int memory_size);
+void engine_prepare(DecodedProgram* program, const uint32_t* words, int count, int memory_size);
+void engine_reset(PackedMachine* machine, const DecodedProgram* program);
+void engine_poke(PackedMachine* machine, int address, uint32_t value);
+long long engine_run(PackedMachine* machine, long long budget);
+long long engine_run_traced(PackedMachine* machine, long long budget, EngineEdgeHook hook, void* context);
+void engine_from_computer(PackedMachine* machine, const BabyComputer* computer);
+void engine_to_computer(const PackedMachine* machine, BabyComputer* computer);
+
+#endif
@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "simulator.h"
+#include "engine.h"
+#include "verify.h"
+
+// Coverage bitmap size (power of two)
+#define MAP_SIZE 65536
+// Maximum number of inputs kept in the corpus
+#define MAX_CORPUS 4096
+// Largest store the fuzzer drives
+#define MAX_WORDS 64
+
+// One fuzz case: the complete initial store, program and data alike
+typedef struct {
+    int words[MAX_WORDS];
+} FuzzInput;
+
+static unsigned char trace_map[MAP_SIZE];   // Edge hit counts of the current case
+static unsigned char virgin_map[MAP_SIZE];  // Hit-count buckets seen by any case
+static int touched[MAP_SIZE];               // Entries of trace_map set by this case
+static int touched_count = 0;
+static int edges_seen = 0;
+
+static FuzzInput corpus[MAX_CORPUS];
+static int corpus_count = 0;
+
+// Case being executed, kept as machine code text so the crash handler only
+// has to write it: line a holds word a, WORD_SIZE digits and a newline
+static char crash_text[MAX_WORDS * (WORD_SIZE + 1)];
+static char crash_path[512];                // Output path, crash_digits digits of it replaced by the signal
+static int crash_digits = -1;               // Offset of the signal number in crash_path, -1 if not saving
+static int fuzz_memory_size = 32;
+static const char* output_dir = NULL;
+static int verify_engine = -1;              // Engine checked against the reference, -1 for none
+
+// Display program usage information
+void printFuzzerUsage(const char* programName) {
+    printf("Usage: %s [options] [seed program]...\n", programName);
+    printf("Options:\n");
+    printf("  --mem 32|64   Store size in words (default 32)\n");
+    printf("  --steps N     Step budget per case (default 256)\n");
+    printf("  --runs N      Stop after N cases (default: run forever)\n");
+    printf("  --seed N      Random seed (default: time)\n");
+    printf("  -o DIR        Write new-coverage inputs and crashes to DIR\n");
+    printf("  --verify E    Also run every case on engine E (packed, smp or loop) in lockstep with the reference\n");
+}
+
+// xorshift64* generator: fast and reproducible from --seed
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned int next_random(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (unsigned int)((rng_state * 2685821657736338717ULL) >> 32);
+}
+
+// Build an instruction word value from opcode and operand (store bit order)
+static int make_instruction(int opcode, int operand) {
+    return (operand & 0x1FFF) |
+           (((opcode >> 3) & 1) << 13) | (((opcode >> 2) & 1) << 14) |
+           (((opcode >> 1) & 1) << 15) | ((opcode & 1) << 16) | (((opcode >> 4) & 1) << 17);
+}
+
+// Write an input as a machine code file the simulator can load
+static void save_input(const FuzzInput* input, const char* kind, int id) {
+    if (!output_dir) return;
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s-%06d.txt", output_dir, kind, id);
+    FILE* fp = fopen(path, "w");
+    if (!fp) return;
+    for (int a = 0; a < fuzz_memory_size; a++) {
+        for (int i = 0; i < WORD_SIZE; i++) {
+            fputc('0' + ((input->words[a] >> i) & 1), fp);
+        }
+        fputc('\n', fp);
+    }
+    fclose(fp);
+}
+
+// Render the words in changed into crash_text, the current case as the crash
+// handler will save it
+static void record_case(const FuzzInput* input, unsigned long long changed) {
+    while (changed) {
+        int a = __builtin_ctzll(changed);
+        changed &= changed - 1;
+        char* line = &crash_text[a * (WORD_SIZE + 1)];
+        for (int i = 0; i < WORD_SIZE; i++) {
+            line[i] = '0' + ((input->words[a] >> i) & 1);
+        }
+        line[WORD_SIZE] = '\n';
+    }
+}
+
+// A crash in the core is a finding: keep the input that caused it. Only
+// async-signal-safe calls are made, since the fault may be inside stdio or malloc.
+static void crash_handler(int sig) {
+    if (crash_digits >= 0) {
+        char path[sizeof(crash_path)];
+        memcpy(path, crash_path, sizeof(path));
+        for (int i = 5, n = sig; i >= 0; i--, n /= 10) {
+            path[crash_digits + i] = '0' + n % 10;
+        }
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0 && write(fd, crash_text, fuzz_memory_size * (WORD_SIZE + 1)) < 0) {
+            // Nothing more can be done inside a signal handler
+        }
+    }
+    static const char message[] = "\n=== Crash: input saved to the output directory ===\n";
+    if (write(STDERR_FILENO, message, sizeof(message) - 1) < 0) {
+        // Nothing more can be done inside a signal handler
+    }
+    _exit(2);
+}
+
+// Bucket hit counts so loops that run longer count as new behaviour
+static unsigned char count_bucket(unsigned char count) {
+    if (count <= 3) return count == 3 ? 4 : count;
+    if (count <= 7) return 8;
+    if (count <= 15) return 16;
+    if (count <= 31) return 32;
+    if (count <= 127) return 64;
+    return 128;
+}
+
+// Record the edge from the previous instruction to (CI, opcode); context
+// holds the previous location
+static void record_edge(void* context, int CI, int opcode) {
+    unsigned int* prev = context;
+    unsigned int location = ((unsigned int)CI << 5 | (unsigned int)opcode) * 2654435761u >> 16;
+    unsigned int edge = (location ^ *prev) & (MAP_SIZE - 1);
+    if (trace_map[edge] == 0) touched[touched_count++] = edge;
+    if (trace_map[edge] < 255) trace_map[edge]++;
+    *prev = location >> 1;
+}
+
+// Put the machine in the initial state of input, re-decoding only the words
+// in changed and those the previous case wrote
+static void reset_machine(PackedMachine* machine, const FuzzInput* input, unsigned long long changed) {
+    unsigned long long restore = machine->dirty | changed;
+    while (restore) {
+        int address = __builtin_ctzll(restore);
+        restore &= restore - 1;
+        engine_poke(machine, address, (uint32_t)input->words[address]);
+    }
+    machine->accumulator = 0;
+    machine->CI = 0;
+    machine->PI = 0;
+    machine->index = 0;
+    machine->running = 1;
+    machine->dirty = 0;
+    machine->cycles = 0;
+    machine->beats = 0;
+}
+
+// Run one case on the packed engine and record (CI, opcode) edges; returns 1 on new coverage
+static int run_case(PackedMachine* machine, long budget) {
+    unsigned int prev = 0;
+    engine_run_traced(machine, budget, record_edge, &prev);
+
+    int new_coverage = 0;
+    for (int i = 0; i < touched_count; i++) {
+        int edge = touched[i];
+        unsigned char bucket = count_bucket(trace_map[edge]);
+        if (!(virgin_map[edge] & bucket)) {
+            if (virgin_map[edge] == 0) edges_seen++;
+            virgin_map[edge] |= bucket;
+            new_coverage = 1;
+        }
+        trace_map[edge] = 0;
+    }
+    touched_count = 0;
+    return new_coverage;
+}
+
+// Apply a few random mutations to program words and data
+static void mutate(FuzzInput* input) {
+    static const int interesting[] = { 0, 1, -1, 2, 31, 32, 33, 0x7FFFFFFF, (int)0x80000000, 8191 };
+    int rounds = 1 + next_random() % 4;
+
+    for (int r = 0; r < rounds; r++) {
+        int a = next_random() % fuzz_memory_size;
+        switch (next_random() % 6) {
+            case 0:  // Flip one bit
+                input->words[a] ^= 1u << (next_random() % WORD_SIZE);
+                break;
+            case 1:  // New instruction with an in-store operand, a quarter of them with an addressing mode
+                input->words[a] = make_instruction(next_random() % (LDX + 1), next_random() % fuzz_memory_size);
+                if (next_random() % 4 == 0) {
+                    input->words[a] |= (int)(next_random() % 8) << MODE_COLUMN;
+                }
+                break;
+            case 2:  // Retarget the operand, keeping the opcode
+                input->words[a] = (input->words[a] & ~0x1FFF) | (int)(next_random() % fuzz_memory_size);
+                break;
+            case 3:  // Boundary value as data
+                input->words[a] = interesting[next_random() % (sizeof(interesting) / sizeof(interesting[0]))];
+                break;
+            case 4:  // Copy another word
+                input->words[a] = input->words[next_random() % fuzz_memory_size];
+                break;
+            case 5:  // Splice the tail of another corpus entry
+                if (corpus_count > 0) {
+                    const FuzzInput* other = &corpus[next_random() % corpus_count];
+                    memcpy(&input->words[a], &other->words[a], (fuzz_memory_size - a) * sizeof(int));
+                }
+                break;
+        }
+    }
+}
+
+// Add a seed program to the corpus
+static int add_seed(BabyComputer* computer, const char* filename) {
+    static const int empty[MAX_WORDS];
+    reset_computer(computer, empty, ~0ULL >> (64 - fuzz_memory_size));
+    if (load_program(computer, filename) != 0) return -1;
+    FuzzInput* input = &corpus[corpus_count++];
+    memset(input, 0, sizeof(*input));
+    for (int a = 0; a < fuzz_memory_size; a++) {
+        input->words[a] = get_value_from_address(computer, a);
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    long budget = 256;
+    long runs = 0;
+    unsigned long long seed = (unsigned long long)time(NULL);
+    BabyComputer computer;
+
+    int first_seed = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mem") == 0 && i + 1 < argc) {
+            fuzz_memory_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            budget = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc &&
+                   verify_parse_engine(argv[i + 1]) >= 0) {
+            verify_engine = verify_parse_engine(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            printFuzzerUsage(argv[0]);
+            return 1;
+        } else {
+            first_seed = i;
+            break;
+        }
+    }
+    if ((fuzz_memory_size != 32 && fuzz_memory_size != 64) || budget <= 0) {
+        printFuzzerUsage(argv[0]);
+        return 1;
+    }
+    rng_state ^= seed * 0x9E3779B97F4A7C15ULL;
+    if (output_dir) mkdir(output_dir, 0755);
+
+    initialize_computer(&computer, fuzz_memory_size);
+    computer.trace = LOG_OFF;
+    for (int i = first_seed; i < argc; i++) {
+        if (add_seed(&computer, argv[i]) < 0) return 1;
+    }
+    if (corpus_count == 0) {
+        // Built-in seed: padding word followed by STP
+        memset(&corpus[0], 0, sizeof(FuzzInput));
+        corpus[0].words[1] = make_instruction(0b1110, 0);
+        corpus_count = 1;
+    }
+
+    if (output_dir) {
+        int length = snprintf(crash_path, sizeof(crash_path), "%s/crash-000000.txt", output_dir);
+        crash_digits = length > 0 && length < (int)sizeof(crash_path) ? length - 10 : -1;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = crash_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND;
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGFPE, &action, NULL);
+    sigaction(SIGBUS, &action, NULL);
+
+    // Cases run on the packed engine, set up once; each case only re-decodes the
+    // words that differ from the previous case or that the previous case wrote
+    static PackedMachine machine;
+    const unsigned long long all_words = ~0ULL >> (64 - fuzz_memory_size);
+    FuzzInput previous, input;
+    memcpy(&previous, &corpus[0], sizeof(FuzzInput));
+    machine.memory_size = fuzz_memory_size;
+    reset_machine(&machine, &previous, all_words);
+    record_case(&previous, all_words);
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double last_report = 0;
+    long execs = 0;
+    long divergences = 0;
+
+    while (runs == 0 || execs < runs) {
+        memcpy(&input, &corpus[next_random() % corpus_count], sizeof(FuzzInput));
+        mutate(&input);
+
+        unsigned long long changed = 0;
+        for (int a = 0; a < fuzz_memory_size; a++) {
+            if (input.words[a] != previous.words[a]) changed |= 1ULL << a;
+        }
+        reset_machine(&machine, &input, changed);
+        record_case(&input, changed);
+        memcpy(&previous, &input, sizeof(FuzzInput));
+
+        if (run_case(&machine, budget) && corpus_count < MAX_CORPUS) {
+            memcpy(&corpus[corpus_count], &input, sizeof(FuzzInput));
+            save_input(&input, "cov", corpus_count);
+            corpus_count++;
+        }
+        if (verify_engine >= 0) {
+            // Replay the case from its initial store on the reference and the engine under test
+            VerifyReport report;
+            reset_computer(&computer, input.words, all_words);
+            if (verify_run(&computer, verify_engine, budget, &report) < 0) {
+                save_input(&input, "diverge", (int)divergences);
+                printf("=== Divergence %ld (case %ld) ===\n", divergences, execs);
+                verify_print(&report, verify_engine, fuzz_memory_size);
+                divergences++;
+            }
+        }
+        execs++;
+
+        if ((execs & 0xFFF) == 0 || (runs != 0 && execs == runs)) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            double elapsed = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+            if (elapsed - last_report >= 1.0 || (runs != 0 && execs == runs)) {
+                printf("#%ld corpus: %d edges: %d exec/s: %.0f", execs, corpus_count, edges_seen, execs / elapsed);
+                if (verify_engine >= 0) {
+                    printf(" divergences: %ld", divergences);
+                }
+                printf("\n");
+                fflush(stdout);
+                last_report = elapsed;
+            }
+        }
+    }
+
+    free_computer(&computer);
+    return divergences ? 1 : 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "simulator.h"
+
+// Consistent copy of the published state
+typedef struct {
+    int memory_size;
+    int accumulator;
+    int CI;
+    int PI;
+    int running;
+    long long cycles;
+    int words[SHARED_STORE_WORDS];
+} Sample;
+
+// Display program usage information
+void printInspectUsage(const char* programName) {
+    printf("Usage: %s <segment name> [--interval ms] [--count N] [--memory]\n", programName);
+    printf("Samples a simulator started with --shm <segment name>.\n");
+    printf("  --interval  Time between samples in milliseconds (default 1000)\n");
+    printf("  --count     Number of samples (default: until the program stops)\n");
+    printf("  --memory    Print the whole store in every sample, not only changed words\n");
+}
+
+// Seqlock read: retry until no cycle was in progress during the copy
+static void take_sample(const BabySharedState* shared, Sample* sample) {
+    unsigned int before, after;
+    do {
+        before = atomic_load_explicit(&((BabySharedState*)shared)->sequence, memory_order_acquire);
+        if (before & 1) continue;
+
+        // A torn or foreign size must not overflow words before the retry check
+        sample->memory_size = shared->memory_size;
+        if (sample->memory_size < 0) sample->memory_size = 0;
+        if (sample->memory_size > SHARED_STORE_WORDS) sample->memory_size = SHARED_STORE_WORDS;
+        sample->accumulator = shared->accumulator;
+        sample->CI = shared->CI;
+        sample->PI = shared->PI;
+        sample->running = shared->running;
+        sample->cycles = shared->cycles;
+        for (int a = 0; a < sample->memory_size; a++) {
+            int value = 0;
+            for (int j = 0; j < WORD_SIZE; j++) {
+                value |= (shared->store[a][j] & 1) << j;
+            }
+            sample->words[a] = value;
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&((BabySharedState*)shared)->sequence, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+int main(int argc, char* argv[]) {
+    int interval_ms = 1000;
+    long count = 0;
+    int full_memory = 0;
+
+    if (argc < 2 || argv[1][0] == '-') {
+        printInspectUsage(argv[0]);
+        return 1;
+    }
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--memory") == 0) {
+            full_memory = 1;
+        } else {
+            printInspectUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    int fd = shm_open(argv[1], O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Error: No simulator is publishing '%s'\n", argv[1]);
+        return 1;
+    }
+    const BabySharedState* shared = mmap(NULL, sizeof(BabySharedState), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shared == MAP_FAILED || shared->magic != SHARED_STATE_MAGIC) {
+        printf("Error: '%s' is not a simulator state segment\n", argv[1]);
+        return 1;
+    }
+
+    Sample previous, sample;
+    take_sample(shared, &previous);
+    struct timespec last, now;
+    clock_gettime(CLOCK_MONOTONIC, &last);
+
+    for (long n = 0; count == 0 || n < count; n++) {
+        usleep(interval_ms * 1000);
+        take_sample(shared, &sample);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsed = (now.tv_sec - last.tv_sec) + (now.tv_nsec - last.tv_nsec) / 1e9;
+        last = now;
+
+        printf("\n=== Sample %ld ===\n", n + 1);
+        printf("State: %s, cycles: %lld, cycles/sec: %.0f\n", sample.running ? "running" : "stopped",
+               sample.cycles, (sample.cycles - previous.cycles) / elapsed);
+        printf("CI: %d, PI: %d, A: %d\n", sample.CI, sample.PI, sample.accumulator);
+
+        int changed = 0;
+        for (int a = 0; a < sample.memory_size; a++) {
+            if (full_memory || sample.words[a] != previous.words[a]) {
+                printf("%2d: %d\n", a, sample.words[a]);
+                changed += sample.words[a] != previous.words[a];
+            }
+        }
+        printf("Words changed since last sample: %d\n", changed);
+        fflush(stdout);
+
+        previous = sample;
+        if (!sample.running) break;
+    }
+
+    munmap((void*)shared, sizeof(BabySharedState));
+    return 0;
+}
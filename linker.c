@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "assembler.h"
+
+// One relocatable module loaded from an object file
+typedef struct {
+    char fileName[MAX_LINE_LENGTH];  // Object file path
+    uint32_t *words;                 // Module code and data
+    int wordCount;                   // Number of words in the module
+    SymbolTable exports;             // Exported labels (module-relative addresses)
+    Relocation *relocs;              // Operand fields to patch
+    int relocCount;                  // Number of relocation entries
+    int base;                        // Load address assigned by the linker
+} ObjectModule;
+
+// Display program usage information
+void printLinkerUsage(const char *programName) {
+    printf("Usage: %s -o <output file> [-q] [--log LEVEL] <module>...\n", programName);
+    printf("Modules are object files (.obj) or assembly sources; sources are\n");
+    printf("assembled to <name>.obj and only reassembled when the object is stale.\n");
+    printf("Options:\n");
+    printf("  -o    Linked machine code output file\n");
+    printf("  -q    Quiet mode (no verbose output, same as --log summary)\n");
+    printf("  --log LEVEL  Messages: off, summary or instruction (default instruction)\n");
+}
+
+// Derive the cached object path for a source module
+void objectPathFor(const char *source, char *object, size_t size) {
+    snprintf(object, size, "%s", source);
+    char *dot = strrchr(object, '.');
+    char *slash = strrchr(object, '/');
+    if (dot && (!slash || dot > slash)) *dot = '\0';
+    strncat(object, ".obj", size - strlen(object) - 1);
+}
+
+// Check whether an object is missing or older than its source
+int objectIsStale(const char *source, const char *object) {
+    struct stat src, obj;
+    if (stat(source, &src) != 0) return 1;
+    if (stat(object, &obj) != 0) return 1;
+    if (src.st_mtim.tv_sec != obj.st_mtim.tv_sec) {
+        return src.st_mtim.tv_sec > obj.st_mtim.tv_sec;
+    }
+    return src.st_mtim.tv_nsec > obj.st_mtim.tv_nsec;
+}
+
+// Parse a 32-character word written most significant bit first
+int parseWord(const char *text, uint32_t *word) {
+    *word = 0;
+    for (int i = 0; i < 32; i++) {
+        if (text[i] != '0' && text[i] != '1') return -1;
+        *word = (*word << 1) | (uint32_t)(text[i] - '0');
+    }
+    return 0;
+}
+
+// Load an object file produced by the assembler's -c mode
+int loadObject(ObjectModule *module, const char *fileName) {
+    FILE *fp = fopen(fileName, "r");
+    if (!fp) {
+        LOG_FLUSH();
+        printf("Error: Unable to open object file '%s'\n", fileName);
+        return -1;
+    }
+
+    memset(module, 0, sizeof(*module));
+    snprintf(module->fileName, sizeof(module->fileName), "%s", fileName);
+
+    char line[MAX_LINE_LENGTH];
+    char name[MAX_LINE_LENGTH];
+    int value;
+    if (!fgets(line, sizeof(line), fp) || strncmp(line, OBJECT_MAGIC, strlen(OBJECT_MAGIC)) != 0 ||
+        !fgets(line, sizeof(line), fp) || sscanf(line, "WORDS %d", &module->wordCount) != 1 ||
+        module->wordCount < 0) {
+        LOG_FLUSH();
+        printf("Error: '%s' is not a valid object file\n", fileName);
+        fclose(fp);
+        return -1;
+    }
+
+    module->words = malloc((module->wordCount > 0 ? module->wordCount : 1) * sizeof(uint32_t));
+    module->relocs = malloc((module->wordCount > 0 ? module->wordCount : 1) * sizeof(Relocation));
+    for (int i = 0; i < module->wordCount; i++) {
+        if (!fgets(line, sizeof(line), fp) || parseWord(line, &module->words[i]) < 0) {
+            LOG_FLUSH();
+            printf("Error: Corrupt code section in '%s'\n", fileName);
+            fclose(fp);
+            return -1;
+        }
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "END", 3) == 0) {
+            fclose(fp);
+            return 0;
+        } else if (sscanf(line, "EXPORT %255s %d", name, &value) == 2) {
+            if (addSymbol(&module->exports, name, value) < 0) break;
+        } else if (strncmp(line, "IMPORT ", 7) == 0) {
+            // Imports are implied by the relocation entries that use them
+        } else if (sscanf(line, "RELOC %d", &value) == 1 && value >= 0 && value < module->wordCount &&
+                   module->relocCount < module->wordCount) {
+            Relocation *reloc = &module->relocs[module->relocCount++];
+            reloc->word = value;
+            if (sscanf(line, "RELOC %*d %255s", reloc->symbol) != 1) {
+                reloc->symbol[0] = '\0';
+            }
+        } else {
+            break;
+        }
+    }
+
+    LOG_FLUSH();
+    printf("Error: Corrupt symbol section in '%s'\n", fileName);
+    fclose(fp);
+    return -1;
+}
+
+// Lay out modules, resolve symbols and write the final image
+int linkModules(ObjectModule *modules, int moduleCount, const char *outputFile, int logLevel) {
+    SymbolTable globals;
+    globals.count = 0;
+
+    // Modules are placed back to back in command line order
+    int address = 0;
+    for (int m = 0; m < moduleCount; m++) {
+        modules[m].base = address;
+        for (int i = 0; i < modules[m].exports.count; i++) {
+            Symbol *sym = &modules[m].exports.symbols[i];
+            if (addSymbol(&globals, sym->name, modules[m].base + sym->address) < 0) {
+                LOG_FLUSH();
+                printf("Error: '%s' exported by more than one module\n", sym->name);
+                return -1;
+            }
+        }
+        LOG_AT(logLevel, LOG_INSTRUCTION, "Module '%s' at address %d (%d words)\n",
+               modules[m].fileName, modules[m].base, modules[m].wordCount);
+        address += modules[m].wordCount;
+    }
+    if (address > MEMORY_SIZE) {
+        LOG_FLUSH();
+        printf("Warning: Linked image has %d words, more than the %d-word store\n", address, MEMORY_SIZE);
+    }
+
+    // Patch 13-bit operand fields
+    for (int m = 0; m < moduleCount; m++) {
+        for (int r = 0; r < modules[m].relocCount; r++) {
+            Relocation *reloc = &modules[m].relocs[r];
+            uint32_t *word = &modules[m].words[reloc->word];
+            int target;
+            if (reloc->symbol[0]) {
+                target = findSymbol(&globals, reloc->symbol);
+                if (target < 0) {
+                    LOG_FLUSH();
+                    printf("Error: Undefined symbol '%s' imported by '%s'\n",
+                           reloc->symbol, modules[m].fileName);
+                    return -1;
+                }
+            } else {
+                target = decodeAddress(*word) + modules[m].base;
+            }
+            if (target >= (1 << 13)) {
+                LOG_FLUSH();
+                printf("Error: Relocated address %d does not fit the operand field\n", target);
+                return -1;
+            }
+            *word = (*word & ~ADDRESS_MASK) | encodeAddress(target);
+        }
+    }
+
+    FILE *outFp = fopen(outputFile, "w");
+    if (!outFp) {
+        LOG_FLUSH();
+        printf("Error: Unable to open output file '%s'\n", outputFile);
+        return -1;
+    }
+    for (int m = 0; m < moduleCount; m++) {
+        for (int w = 0; w < modules[m].wordCount; w++) {
+            for (int i = 31; i >= 0; i--) {
+                fprintf(outFp, "%d", (modules[m].words[w] >> i) & 1);
+            }
+            fprintf(outFp, "\n");
+        }
+    }
+    fclose(outFp);
+
+    LOG_AT(logLevel, LOG_SUMMARY, "Linked %d module(s) into '%s' (%d words)\n", moduleCount, outputFile, address);
+    LOG_FLUSH();
+    return 0;
+}
+
+// Main function
+int main(int argc, char *argv[]) {
+    int logLevel = LOG_INSTRUCTION;
+    const char *outputFile = NULL;
+    const char **inputs = malloc(argc * sizeof(char *));
+    int inputCount = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputFile = argv[++i];
+        } else if (strcmp(argv[i], "-q") == 0) {
+            logLevel = LOG_SUMMARY;
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc &&
+                   log_parse_level(argv[i + 1]) >= LOG_OFF) {
+            logLevel = log_parse_level(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            printLinkerUsage(argv[0]);
+            return 1;
+        } else {
+            inputs[inputCount++] = argv[i];
+        }
+    }
+    if (!outputFile || inputCount == 0) {
+        printLinkerUsage(argv[0]);
+        return 1;
+    }
+
+    ObjectModule *modules = calloc(inputCount, sizeof(ObjectModule));
+    for (int i = 0; i < inputCount; i++) {
+        char objectFile[MAX_LINE_LENGTH];
+        const char *ext = strrchr(inputs[i], '.');
+        if (ext && strcmp(ext, ".obj") == 0) {
+            snprintf(objectFile, sizeof(objectFile), "%s", inputs[i]);
+        } else {
+            // Source module: reuse the cached object unless the source changed
+            objectPathFor(inputs[i], objectFile, sizeof(objectFile));
+            if (objectIsStale(inputs[i], objectFile)) {
+                if (assembleObject(inputs[i], objectFile, logLevel) < 0) {
+                    return 1;
+                }
+            } else {
+                LOG_AT(logLevel, LOG_INSTRUCTION, "Using cached object '%s'\n", objectFile);
+            }
+        }
+        if (loadObject(&modules[i], objectFile) < 0) {
+            return 1;
+        }
+    }
+
+    return linkModules(modules, inputCount, outputFile, logLevel) < 0 ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "log.h"
+
+// Each thread formats into its own buffer, so logging takes no stdio lock
+static __thread char log_buffer[LOG_BUFFER_SIZE];
+__thread size_t log_pending = 0;
+
+// Append formatted text to this thread's buffer, writing it out when nearly full
+void log_printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t room = LOG_BUFFER_SIZE - log_pending;
+    int length = vsnprintf(log_buffer + log_pending, room, format, args);
+    va_end(args);
+    if (length < 0) return;
+
+    if ((size_t)length >= room) {
+        // Did not fit: write out what is buffered and format again from the start
+        log_flush();
+        va_start(args, format);
+        length = vsnprintf(log_buffer, LOG_BUFFER_SIZE, format, args);
+        va_end(args);
+        if (length < 0) return;
+        if ((size_t)length >= LOG_BUFFER_SIZE) length = LOG_BUFFER_SIZE - 1;
+    }
+    log_pending += (size_t)length;
+    if (log_pending > LOG_BUFFER_SIZE - LOG_FLUSH_MARGIN) {
+        log_flush();
+    }
+}
+
+// Append the low width bits of value, least significant first (as print_binary)
+void log_binary(int value, int width) {
+    if (LOG_BUFFER_SIZE - log_pending <= (size_t)width) {
+        log_flush();
+    }
+    for (int i = 0; i < width; i++) {
+        log_buffer[log_pending++] = ((value >> i) & 1) ? '1' : '0';
+    }
+}
+
+// Write this thread's buffered log text to stdout
+void log_flush(void) {
+    if (log_pending) {
+        fwrite(log_buffer, 1, log_pending, stdout);
+        log_pending = 0;
+    }
+}
+
+// Level from its name (off, summary, instruction, micro-op); -1 if unknown
+int log_parse_level(const char* name) {
+    static const char* const names[] = { "off", "summary", "instruction", "micro-op" };
+    for (int level = LOG_OFF; level <= LOG_MICROOP; level++) {
+        if (strcmp(name, names[level]) == 0) return level;
+    }
+    return -1;
+}
@@ -0,0 +1,44 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stddef.h>
+
+// Diagnostic verbosity; each level includes the ones below it
+typedef enum {
+    LOG_OFF = 0,                // Nothing
+    LOG_SUMMARY = 1,            // One line per load, pass or run
+    LOG_INSTRUCTION = 2,        // One line per instruction or source line
+    LOG_MICROOP = 3             // Fetch/decode stages and every store access
+} LogLevel;
+
+// Highest level compiled in; build with -DBABY_LOG_MAX=0 to remove all logging
+#ifndef BABY_LOG_MAX
+#define BABY_LOG_MAX LOG_MICROOP
+#endif
+
+// Size of each thread's log buffer; it is written out when less than
+// LOG_FLUSH_MARGIN bytes are left or when other output is about to be printed
+#define LOG_BUFFER_SIZE 65536
+#define LOG_FLUSH_MARGIN 1024
+
+// Bytes waiting in this thread's log buffer
+extern __thread size_t log_pending;
+
+// Whether messages at level are logged at the current verbosity: levels above
+// BABY_LOG_MAX are removed by the compiler, the others cost one compare
+#define LOG_ENABLED(current, level) ((level) <= BABY_LOG_MAX && (level) <= (current))
+// Log at level when the current verbosity allows it
+#define LOG_AT(current, level, ...) \
+    do { if (LOG_ENABLED(current, level)) log_printf(__VA_ARGS__); } while (0)
+#define LOG_BINARY_AT(current, level, value, width) \
+    do { if (LOG_ENABLED(current, level)) log_binary(value, width); } while (0)
+// Write out buffered log text before printing anything else
+#define LOG_FLUSH() do { if (BABY_LOG_MAX > LOG_OFF && log_pending) log_flush(); } while (0)
+
+// Function declarations
+void log_printf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+void log_binary(int value, int width);
+void log_flush(void);
+int log_parse_level(const char* name);
+
+#endif
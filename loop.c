@@ -0,0 +1,362 @@
+#include <string.h>
+#include "loop.h"
+
+// Terms of an affine form: A, the words written by the loop, then the constant 1
+#define LOOP_TERMS (LOOP_MAX_WORDS + 2)
+
+// Exit test of a loop body
+typedef enum {
+    LOOP_NO_EXIT = 0,           // No TAS: the loop runs until the budget ends
+    LOOP_EXIT_ZERO = 1,         // TAS skips the jump back when the word was 0
+    LOOP_EXIT_NONZERO = 2       // TAS skips the jump out when the word was 0
+} LoopExit;
+
+// One iteration of a loop as an affine map over its terms, modulo 2^32
+typedef struct {
+    int length;                 // Instructions per iteration
+    long long beats;            // Beats per iteration
+    int words;                  // Store words written by the loop
+    int address[LOOP_MAX_WORDS];            // Their store addresses
+    int terms;                  // words + 2
+    uint32_t map[LOOP_TERMS][LOOP_TERMS];   // Row t: term t after an iteration in terms of before
+    LoopExit exit;              // How the loop leaves
+    uint32_t tested[LOOP_TERMS];            // Word read by TAS, in terms of the iteration's start
+    int last;                   // Address of the last instruction of an iteration
+} LoopSummary;
+
+// Form of a single term
+static void form_term(uint32_t* form, int terms, int term, uint32_t value) {
+    memset(form, 0, terms * sizeof(uint32_t));
+    form[term] = value;
+}
+
+// Whether a form is a constant (no register or variable word in it)
+static int form_constant(const uint32_t* form, int terms) {
+    for (int t = 0; t < terms - 1; t++) {
+        if (form[t]) return 0;
+    }
+    return 1;
+}
+
+// Row vector times the map: the form after one more iteration
+static void form_step(uint32_t* out, const uint32_t* form, const LoopSummary* loop) {
+    for (int c = 0; c < loop->terms; c++) {
+        uint32_t sum = 0;
+        for (int r = 0; r < loop->terms; r++) {
+            sum += form[r] * loop->map[r][c];
+        }
+        out[c] = sum;
+    }
+}
+
+// Value of a form for concrete terms
+static uint32_t form_value(const uint32_t* form, const uint32_t* values, int terms) {
+    uint32_t sum = 0;
+    for (int t = 0; t < terms; t++) {
+        sum += form[t] * values[t];
+    }
+    return sum;
+}
+
+// Walk the loop through head symbolically and describe one iteration.
+// Returns -1 when the path from head does not come back to it as a simple cycle,
+// writes its own code, has an exit other than one TAS, or is not affine.
+static int summarize(const PackedMachine* machine, int head, LoopSummary* loop) {
+    const int size = machine->memory_size;
+    int path[LOOP_MAX_LENGTH];
+    unsigned long long visited = 0, written = 0;
+    int tas = -1;
+
+    // Find the path of one iteration, taking the branch of a TAS that stays in the loop
+    memset(loop, 0, sizeof(*loop));
+    int ci = head;
+    do {
+        if (loop->length == LOOP_MAX_LENGTH || (visited >> ci & 1)) return -1;
+        visited |= 1ULL << ci;
+        path[loop->length++] = ci;
+
+        DecodedWord instruction = machine->decoded[ci];
+        int next = ci + 1 == size ? 0 : ci + 1;
+        if (ci != 0 && ((instruction.mode != DIRECT && instruction.mode != IMMEDIATE) ||
+                        instruction.opcode == LDX)) {
+            // Operands that depend on the index register or a pointer word
+            return -1;
+        }
+        if (ci == 0) {
+            next = 1;
+        } else if (instruction.opcode == JMP) {
+            next = instruction.address;
+        } else if (instruction.opcode == JRP) {
+            next = (ci + instruction.address) % size;
+        } else if (instruction.opcode == STP) {
+            return -1;
+        } else if (instruction.opcode == STO) {
+            written |= 1ULL << instruction.address;
+        } else if (instruction.opcode == TAS) {
+            // The word after TAS must be a jump: back to head, or out of the loop
+            DecodedWord jump = machine->decoded[next];
+            if (tas >= 0 || next == 0 || (jump.opcode != JMP && jump.opcode != JRP) || jump.mode != DIRECT) {
+                return -1;
+            }
+            int target = jump.opcode == JMP ? jump.address : (next + jump.address) % size;
+            tas = ci;
+            written |= 1ULL << instruction.address;
+            if (target == head) {
+                loop->exit = LOOP_EXIT_ZERO;
+            } else {
+                loop->exit = LOOP_EXIT_NONZERO;
+                next = next + 1 == size ? 0 : next + 1;
+            }
+        }
+        ci = next;
+    } while (ci != head);
+    if (written & visited) return -1;
+    if (__builtin_popcountll(written) > LOOP_MAX_WORDS) return -1;
+
+    // Number the written words; every other word keeps its value through the loop
+    int term_of[ENGINE_MAX_WORDS] = {0};
+    for (unsigned long long rest = written; rest; rest &= rest - 1) {
+        int address = __builtin_ctzll(rest);
+        loop->address[loop->words] = address;
+        term_of[address] = ++loop->words;
+    }
+    loop->terms = loop->words + 2;
+    const int terms = loop->terms;
+    const int one = terms - 1;
+
+    // Execute the path on forms over the iteration's starting terms
+    uint32_t current[LOOP_TERMS][LOOP_TERMS];
+    for (int t = 0; t < terms; t++) {
+        form_term(current[t], terms, t, 1);
+    }
+    uint32_t* acc = current[0];
+    for (int i = 0; i < loop->length; i++) {
+        ci = path[i];
+        if (ci == 0) {
+            loop->beats += engine_beats[CMP];
+            continue;
+        }
+        DecodedWord instruction = machine->decoded[ci];
+        loop->beats += instruction.beats;
+
+        uint32_t value[LOOP_TERMS];
+        int address = instruction.address;
+        if (instruction.mode == IMMEDIATE) {
+            form_term(value, terms, one, address);
+        } else if (term_of[address]) {
+            memcpy(value, current[term_of[address]], sizeof(value));
+        } else {
+            form_term(value, terms, one, machine->words[address]);
+        }
+
+        switch (instruction.opcode) {
+            case JMP:
+            case JRP:
+            case CMP:
+                break;
+            case STO:
+                memcpy(current[term_of[address]], acc, sizeof(value));
+                break;
+            case TAS:
+                memcpy(loop->tested, value, sizeof(value));
+                memcpy(acc, value, sizeof(value));
+                form_term(current[term_of[address]], terms, one, 1);
+                break;
+            case LDN:
+                for (int t = 0; t < terms; t++) acc[t] = 0u - value[t];
+                break;
+            case ADD:
+                for (int t = 0; t < terms; t++) acc[t] += value[t];
+                break;
+            case SUB:
+            case SUB2:
+                for (int t = 0; t < terms; t++) acc[t] -= value[t];
+                break;
+            default:
+                if (form_constant(acc, terms) && form_constant(value, terms)) {
+                    acc[one] = engine_alu(instruction.opcode, acc[one], value[one]);
+                } else if ((instruction.opcode == MUL || instruction.opcode == SHL) &&
+                           form_constant(value, terms)) {
+                    // A times a constant, and a left shift by a constant, stay affine
+                    uint32_t factor = engine_alu(instruction.opcode, 1, value[one]);
+                    for (int t = 0; t < terms; t++) acc[t] *= factor;
+                } else if (instruction.opcode == MUL && form_constant(acc, terms)) {
+                    uint32_t factor = acc[one];
+                    for (int t = 0; t < terms; t++) acc[t] = value[t] * factor;
+                } else if (instruction.opcode >= TAS) {
+                    // Unassigned extension opcodes do nothing
+                } else {
+                    return -1;
+                }
+                break;
+        }
+    }
+    memcpy(loop->map, current, sizeof(loop->map));
+    loop->last = path[loop->length - 1];
+    return 0;
+}
+
+// Smallest i >= 0 with start + i * step == 0 modulo 2^32, or -1 if there is none
+static long long first_zero(uint32_t start, uint32_t step) {
+    if (start == 0) return 0;
+    if (step == 0) return -1;
+    int shift = __builtin_ctz(step);
+    if (start & ((1u << shift) - 1)) return -1;
+
+    // Invert the odd part of step by Newton's iteration, exact modulo 2^32 after five steps
+    uint32_t odd = step >> shift;
+    uint32_t inverse = odd;
+    for (int k = 0; k < 5; k++) inverse *= 2 - odd * inverse;
+    uint64_t mask = (1ULL << (32 - shift)) - 1;
+    return (long long)(((0u - start) >> shift) * inverse & mask);
+}
+
+// Iterations the loop makes before the one that leaves it, -1 if it never leaves.
+// The word TAS tests must change by the same amount every iteration; returns -2 otherwise.
+static long long trip_count(const LoopSummary* loop, const uint32_t* values) {
+    if (loop->exit == LOOP_NO_EXIT) return -1;
+
+    // Linear in the iteration number when its change per iteration is itself invariant
+    uint32_t next[LOOP_TERMS], change[LOOP_TERMS], later[LOOP_TERMS];
+    form_step(next, loop->tested, loop);
+    for (int t = 0; t < loop->terms; t++) change[t] = next[t] - loop->tested[t];
+    form_step(later, change, loop);
+    if (memcmp(later, change, loop->terms * sizeof(uint32_t)) != 0) return -2;
+
+    uint32_t start = form_value(loop->tested, values, loop->terms);
+    uint32_t step = form_value(change, values, loop->terms);
+    if (loop->exit == LOOP_EXIT_ZERO) {
+        return first_zero(start, step);
+    }
+    return start != 0 ? 0 : step != 0 ? 1 : -1;
+}
+
+// Multiply two maps: out = a * b
+static void map_multiply(uint32_t out[LOOP_TERMS][LOOP_TERMS], uint32_t a[LOOP_TERMS][LOOP_TERMS],
+                         uint32_t b[LOOP_TERMS][LOOP_TERMS], int terms) {
+    uint32_t product[LOOP_TERMS][LOOP_TERMS];
+    for (int r = 0; r < terms; r++) {
+        for (int c = 0; c < terms; c++) {
+            uint32_t sum = 0;
+            for (int k = 0; k < terms; k++) {
+                sum += a[r][k] * b[k][c];
+            }
+            product[r][c] = sum;
+        }
+    }
+    memcpy(out, product, sizeof(product));
+}
+
+// If CI is on a loop that can be summarized, advance the machine over as many
+// whole iterations as the loop makes before leaving, within budget cycles; the
+// iteration that leaves is left to the engine. Returns the cycles skipped.
+long long loop_skip(PackedMachine* machine, long long budget, LoopStats* stats) {
+    LoopSummary loop;
+    if (!machine->running || summarize(machine, machine->CI, &loop) < 0) return 0;
+
+    const int terms = loop.terms;
+    uint32_t values[LOOP_TERMS];
+    values[0] = (uint32_t)machine->accumulator;
+    for (int w = 0; w < loop.words; w++) {
+        values[w + 1] = machine->words[loop.address[w]];
+    }
+    values[terms - 1] = 1;
+
+    long long iterations = trip_count(&loop, values);
+    if (iterations == -2) return 0;
+    long long limit = budget / loop.length;
+    if (iterations < 0 || iterations > limit) iterations = limit;
+    if (iterations == 0) return 0;
+
+    // Raise the map to the power iterations by squaring, then apply it
+    uint32_t power[LOOP_TERMS][LOOP_TERMS] = {{0}};
+    uint32_t square[LOOP_TERMS][LOOP_TERMS];
+    memcpy(square, loop.map, sizeof(square));
+    for (int t = 0; t < terms; t++) power[t][t] = 1;
+    for (long long n = iterations; n; n >>= 1) {
+        if (n & 1) map_multiply(power, power, square, terms);
+        if (n > 1) map_multiply(square, square, square, terms);
+    }
+
+    machine->accumulator = (int32_t)form_value(power[0], values, terms);
+    for (int w = 0; w < loop.words; w++) {
+        int address = loop.address[w];
+        machine->words[address] = form_value(power[w + 1], values, terms);
+        machine->decoded[address] = engine_decode(machine->words[address], address, machine->memory_size);
+        machine->dirty |= 1ULL << address;
+    }
+    machine->PI = machine->words[loop.last];
+    machine->cycles += iterations * loop.length;
+    machine->beats = (long long)((unsigned long long)machine->beats + (unsigned long long)iterations * loop.beats);
+    if (stats) {
+        stats->loops++;
+        stats->iterations += iterations;
+        stats->cycles += iterations * loop.length;
+    }
+    return iterations * loop.length;
+}
+
+// Head of a loop that jumps back after a TAS: the target of that jump, found
+// by following the path from CI up to the first TAS. -1 if there is none within
+// LOOP_MAX_LENGTH instructions.
+static int loop_head(const PackedMachine* machine) {
+    const int size = machine->memory_size;
+    int ci = machine->CI;
+    for (int n = 0; n < LOOP_MAX_LENGTH; n++) {
+        DecodedWord instruction = machine->decoded[ci];
+        int next = ci + 1 == size ? 0 : ci + 1;
+        if (ci == 0) {
+            next = 1;
+        } else if (instruction.mode != DIRECT && instruction.mode != IMMEDIATE) {
+            return -1;
+        } else if (instruction.opcode == JMP) {
+            next = instruction.address;
+        } else if (instruction.opcode == JRP) {
+            next = (ci + instruction.address) % size;
+        } else if (instruction.opcode == STP) {
+            return -1;
+        } else if (instruction.opcode == TAS) {
+            DecodedWord jump = machine->decoded[next];
+            if (next == 0 || (jump.opcode != JMP && jump.opcode != JRP) || jump.mode != DIRECT) {
+                return -1;
+            }
+            return jump.opcode == JMP ? jump.address : (next + jump.address) % size;
+        }
+        ci = next;
+    }
+    return -1;
+}
+
+// Run up to budget cycles like engine_run, summarizing the loop the machine is
+// in whenever it can be; returns the number of cycles executed
+long long loop_run(PackedMachine* machine, long long budget, LoopStats* stats) {
+    long long cycles = 0;
+    long long probe = LOOP_PROBE_MIN;
+    while (machine->running && cycles < budget) {
+        cycles += engine_run(machine, budget - cycles < probe ? budget - cycles : probe);
+        if (!machine->running || cycles == budget) break;
+
+        long long skipped = loop_skip(machine, budget - cycles, stats);
+        if (!skipped) {
+            // A loop that jumps back after its TAS is only summarized from the
+            // jump's target: step the engine there, at most one iteration away
+            int head = loop_head(machine);
+            if (head >= 0 && head != machine->CI) {
+                for (int n = 0; n < LOOP_MAX_LENGTH && machine->CI != head &&
+                                machine->running && cycles < budget; n++) {
+                    cycles += engine_run(machine, 1);
+                }
+                if (machine->CI == head && machine->running && cycles < budget) {
+                    skipped = loop_skip(machine, budget - cycles, stats);
+                }
+            }
+        }
+        cycles += skipped;
+        if (skipped) {
+            probe = LOOP_PROBE_MIN;
+        } else if (probe < LOOP_PROBE_MAX) {
+            probe *= 2;
+        }
+    }
+    return cycles;
+}
@@ -0,0 +1,25 @@
+#ifndef LOOP_H
+#define LOOP_H
+
+#include "engine.h"
+
+// Longest loop body summarized, and most store words it may write
+#define LOOP_MAX_LENGTH 64
+#define LOOP_MAX_WORDS 8
+// Cycles run on the engine between attempts to summarize the loop at CI; the
+// interval doubles after every failed attempt up to LOOP_PROBE_MAX
+#define LOOP_PROBE_MIN 64
+#define LOOP_PROBE_MAX 4096
+
+// Counters of a run with loop acceleration
+typedef struct {
+    long long loops;            // Loops summarized in closed form
+    long long iterations;       // Iterations skipped by the summaries
+    long long cycles;           // Cycles skipped by the summaries
+} LoopStats;
+
+// Function declarations
+long long loop_skip(PackedMachine* machine, long long budget, LoopStats* stats);
+long long loop_run(PackedMachine* machine, long long budget, LoopStats* stats);
+
+#endif
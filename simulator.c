@@ -1,74 +1,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <termios.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "simulator.h"
+#include "cache.h"
+#include "smp.h"
+#include "verify.h"
+#include "loop.h"
 
-#define WORD_SIZE 32
-#ifndef MEMORY_SIZE
-#define MEMORY_SIZE 32  // Default memory size
-#endif
+#ifndef BABY_NO_MAIN
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        return run_headless(argc, argv);
+    }
 
-// Extended instruction set
-typedef enum {
-    // Basic instructions (3-bit opcode -> 4-bit opcode, leftmost is the least significant bit)
-    JMP = 0b0000,    // 0000 = 0, Jump to specified address
-    JRP = 0b1000,    // 1000 = 1, Relative jump from current position
-    LDN = 0b0100,    // 0100 = 2, Load negative value from memory
-    STO = 0b1100,    // 1100 = 3, Store accumulator value to memory
-    SUB = 0b0010,    // 0010 = 4, Subtract value from accumulator
-    SUB2 = 0b1010,   // 1010 = 5, Alternative subtraction
-    CMP = 0b0110,    // 0110 = 6, Compare values
-    STP = 0b1110,    // 1110 = 7, Stop program execution
-    // Extended arithmetic and bitwise operations
-    ADD = 0b0001,    // 0001 = 8, Add value to accumulator
-    MUL = 0b1001,    // 1001 = 9, Multiply accumulator by value
-    DIV = 0b0101,    // 0101 = 10, Divide accumulator by value
-    AND = 0b1101,    // 1101 = 11, Bitwise AND operation
-    OR  = 0b0011,    // 0011 = 12, Bitwise OR operation
-    XOR = 0b1011,    // 1011 = 13, Bitwise XOR operation
-    SHL = 0b0111,    // 0111 = 14, Shift left operation
-    SHR = 0b1111     // 1111 = 15, Shift right operation
-} OpCode;
-
-// Extended addressing mode
-typedef enum {
-    DIRECT = 0,     // Direct addressing
-    INDIRECT = 1,   // Indirect addressing
-    IMMEDIATE = 2,  // Immediate addressing
-    RELATIVE = 3    // Relative addressing
-} AddressingMode;
-
-// Hardware components simulation
-typedef struct {
-    int** store;                // Dynamic memory array
-    int memory_size;            // Current memory size configuration
-    int accumulator;            // Accumulator register
-    int CI;                     // Control Instruction (Program Counter)
-    int PI;                     // Present Instruction register
-    int running;                // Program execution state
-    AddressingMode addr_mode;   // Current addressing mode
-    int index_reg;              // Index register for address calculation
-    int base_reg;               // Base register for address calculation
-} BabyComputer;
-
-// Function declarations
-void initialize_computer(BabyComputer* computer, int memory_size);
-int load_program(BabyComputer* computer, const char* filename);
-void fetch(BabyComputer* computer);
-void decode(BabyComputer* computer, int* opcode, int* operand);
-void execute(BabyComputer* computer, int opcode, int operand);
-void print_state(BabyComputer* computer);
-int convert_to_decimal(int binary[], int size);
-void convert_to_binary(int decimal, int binary[], int size);
-void print_binary(int value, int width);
-int get_effective_address(BabyComputer* computer, int operand);
-int get_value_from_address(BabyComputer* computer, int address);
-void store_value_to_address(BabyComputer* computer, int address, int value);
-
-int main() {
     BabyComputer computer;
     char filename[100];
-    int opcode, operand;
-    int step = 0;
+    long long step = 0;
     int memory_size = 32;  // Default memory size
     char input[10];        // Used to receive user input
 
@@ -173,19 +131,11 @@ int main() {
             
             // Run program
             printf("\n=== Program Execution Started ===\n");
+            print_state(&computer);
             while (computer.running) {
-                printf("\n=== Cycle %d ===\n", step++);
-                
-                printf("\n--- Fetch Stage ---\n");
-                fetch(&computer);
-                
-                printf("\n--- Decode Stage ---\n");
-                decode(&computer, &opcode, &operand);
+                step_computer(&computer, &step);
                 
-                printf("\n--- Execute Stage ---\n");
-                execute(&computer, opcode, operand);
-                
-                print_state(&computer);
+                report_state(&computer, step, 0);
                 
                 if (run_mode == 1) {
                     printf("\nPress Enter to continue...");
@@ -201,11 +151,726 @@ int main() {
     }
 
     // Release memory
-    for (int i = 0; i < computer.memory_size; i++) {
-        free(computer.store[i]);
+    free_computer(&computer);
+
+    return 0;
+}
+
+#endif
+
+// Host clock in nanoseconds
+static unsigned long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Host nanoseconds that a number of beats take at a multiple of the original speed
+static unsigned long long beats_to_ns(long long beats, double speed) {
+    return (unsigned long long)(beats * engine_beat_us * 1000.0 / speed);
+}
+
+// Real-time pacing: sleep while the machine time run since anchor_ns is more
+// than a millisecond ahead of the host clock
+static void pace_realtime(unsigned long long anchor_ns, long long beats, double speed) {
+    unsigned long long due = anchor_ns + beats_to_ns(beats, speed);
+    unsigned long long now = monotonic_ns();
+    if (due > now + 1000000ULL) {
+        usleep((useconds_t)((due - now) / 1000));
+    }
+}
+
+// Print the simulated time of a run on the original machine next to the host time it took
+static void print_timing(long long beats, double host_seconds) {
+    double machine = engine_simulated_seconds(beats);
+    printf("Machine time: %.6f s (%lld beats), host time: %.6f s", machine, beats, host_seconds);
+    if (host_seconds > 0) {
+        printf(" (%.1fx the original speed)", machine / host_seconds);
+    }
+    printf("\n");
+}
+
+// Print how much of a run loop acceleration skipped
+static void print_loops(const LoopStats* stats, long long cycles) {
+    printf("Loop acceleration: %lld loops summarized, %lld iterations (%lld of %lld cycles) skipped\n",
+           stats->loops, stats->iterations, stats->cycles, cycles);
+}
+
+// Run a loaded program to completion on the packed engine with loop acceleration, or
+// copy the result of an identical earlier run from the cache (cache may be NULL);
+// the final state is left in computer
+static long long run_cached(BabyComputer* computer, long max_cycles, ResultCache* cache, int* hit,
+                            LoopStats* stats) {
+    PackedMachine machine;
+    engine_from_computer(&machine, computer);
+    CacheKey key = cache_key(&machine, max_cycles);
+
+    *hit = cache && cache_lookup(cache, key, &machine);
+    if (!*hit) {
+        loop_run(&machine, max_cycles > 0 ? max_cycles : LLONG_MAX, stats);
+        if (cache) {
+            cache_store(cache, key, &machine);
+        }
+    }
+    engine_to_computer(&machine, computer);
+    return machine.cycles;
+}
+
+// Batch mode: run each program listed in a file and print one summary line per program,
+// or check each against the reference when verify names an engine (-1 for none);
+// returns the number of programs that failed to load or diverged
+static int run_batch(const char* list, int memory_size, long max_cycles, ResultCache* cache, int verify) {
+    FILE* fp = strcmp(list, "-") == 0 ? stdin : fopen(list, "r");
+    if (!fp) {
+        printf("Error: File '%s' does not exist\n", list);
+        return 1;
+    }
+
+    static const int empty[SHARED_STORE_WORDS];
+    BabyComputer computer;
+    initialize_computer(&computer, memory_size);
+    computer.trace = LOG_OFF;
+
+    char line[512];
+    int programs = 0, failed = 0, hits = 0, diverged = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '\0' || line[0] == ';') continue;
+
+        programs++;
+        reset_computer(&computer, empty, ~0ULL >> (64 - memory_size));
+        if (load_program(&computer, line) != 0) {
+            failed++;
+            continue;
+        }
+        if (verify >= 0) {
+            VerifyReport report;
+            diverged += verify_run(&computer, verify, max_cycles > 0 ? max_cycles : LLONG_MAX, &report) < 0;
+            printf("%s: ", line);
+            verify_print(&report, verify, memory_size);
+            continue;
+        }
+        int hit;
+        long long cycles = run_cached(&computer, max_cycles, cache, &hit, NULL);
+        hits += hit;
+        printf("%s: %s after %lld cycles (%.6f s machine time), CI %d, A %d%s\n", line,
+               computer.running ? "Stopped" : "Completed", cycles, engine_simulated_seconds(computer.beats),
+               computer.CI, computer.accumulator, hit ? " (cached)" : "");
+    }
+    if (fp != stdin) fclose(fp);
+
+    if (verify >= 0) {
+        printf("\n=== Batch: %d programs, %d failed, %d diverged from the %s engine ===\n",
+               programs, failed, diverged, verify_engine_name(verify));
+    } else {
+        printf("\n=== Batch: %d programs, %d failed, %d answered from the cache ===\n",
+               programs, failed, hits);
+    }
+    free_computer(&computer);
+    return failed + diverged;
+}
+
+// Headless mode: load a program from a file or stdin and run it without menus
+int run_headless(int argc, char* argv[]) {
+    BabyComputer computer;
+    const char* program = NULL;
+    int memory_size = 32;
+    int quiet = 0;
+    int full_every = 0;
+    int tui = 0;
+    int fps = 30;
+    const char* shm_name = NULL;
+    const char* batch = NULL;
+    const char* cache_path = NULL;
+    int cache_entries = CACHE_DEFAULT_ENTRIES;
+    int perf = 0;
+    int accelerate = 0;
+    int cpus = 0;
+    int quantum = 0;
+    const char* beats = NULL;
+    double beat_us = BEAT_MICROSECONDS;
+    double speed = 0;
+    int log_level = -1;
+    int verify = -1;
+    long max_cycles = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--run") == 0 && i + 1 < argc) {
+            program = argv[++i];
+        } else if (strcmp(argv[i], "--mem") == 0 && i + 1 < argc) {
+            memory_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc) {
+            max_cycles = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--full-every") == 0 && i + 1 < argc) {
+            full_every = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_path = argv[++i];
+        } else if (strcmp(argv[i], "--cache-entries") == 0 && i + 1 < argc) {
+            cache_entries = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cpus") == 0 && i + 1 < argc) {
+            cpus = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--round-robin") == 0 && i + 1 < argc) {
+            quantum = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--beats") == 0 && i + 1 < argc) {
+            beats = argv[++i];
+        } else if (strcmp(argv[i], "--beat-us") == 0 && i + 1 < argc) {
+            beat_us = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            if (speed == 0) speed = 1;
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+            if (speed <= 0) speed = -1;
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shm_name = argv[++i];
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            perf = 1;
+            quiet = 1;
+        } else if (strcmp(argv[i], "--accelerate") == 0) {
+            accelerate = 1;
+            quiet = 1;
+        } else if (strcmp(argv[i], "--tui") == 0) {
+            tui = 1;
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc) {
+            verify = verify_parse_engine(argv[++i]);
+            if (verify < 0) verify = -2;
+        } else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            log_level = log_parse_level(argv[++i]);
+            if (log_level < 0) log_level = -2;
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = 1;
+        } else {
+            program = NULL;
+            batch = NULL;
+            break;
+        }
+    }
+    if ((!program && !batch) || (program && batch) || (memory_size != 32 && memory_size != 64) ||
+        fps <= 0 || cache_entries <= 0 || (tui && strcmp(program, "-") == 0) ||
+        (cache_path && program && (!quiet || perf || tui || shm_name)) ||
+        cpus < 0 || cpus > SMP_MAX_CPUS || quantum < 0 || (quantum > 0 && cpus == 0) ||
+        (cpus > 0 && (batch || cache_path || perf || tui || shm_name)) ||
+        (beats && engine_set_timing(beats) < 0) || beat_us <= 0 ||
+        speed < 0 || (speed > 0 && (batch || cache_path || perf || cpus > 0)) || log_level < -1 ||
+        verify < -1 || (verify >= 0 && (cache_path || perf || tui || cpus > 0 || shm_name || speed > 0)) ||
+        (accelerate && (batch || perf || tui || cpus > 0 || shm_name || speed > 0 || verify >= 0))) {
+        printf("Usage: %s --run <program file | -> [--mem 32|64] [--max-cycles N] [--full-every N] [--shm NAME] [--perf] [-q]\n", argv[0]);
+        printf("       %s --run <program file | -> -q --cache FILE [--mem 32|64] [--max-cycles N]\n", argv[0]);
+        printf("       %s --run <program file | -> --accelerate [--mem 32|64] [--max-cycles N]\n", argv[0]);
+        printf("       %s --batch <list file | -> [--cache FILE] [--mem 32|64] [--max-cycles N]\n", argv[0]);
+        printf("       %s --run <program file | -> | --batch <list file | -> --verify packed|smp|loop [--mem 32|64] [--max-cycles N]\n", argv[0]);
+        printf("       %s --run <program file> --tui [--mem 32|64] [--fps N] [--realtime] [--speed F]\n", argv[0]);
+        printf("       %s --run <program file | -> --cpus N [--round-robin Q] [--mem 32|64] [--max-cycles N]\n", argv[0]);
+        printf("  --run         Machine code file, or - to read it from stdin\n");
+        printf("  --mem         Store size in words (default 32)\n");
+        printf("  --max-cycles  Stop after N cycles (default: run until STP)\n");
+        printf("  --full-every  Dump the whole store every N cycles instead of only changes\n");
+        printf("  -q            Only print the final state (log level summary)\n");
+        printf("  --log LEVEL   Diagnostics: off, summary, instruction or micro-op (default micro-op, summary with -q)\n");
+        printf("  --perf        Measure the run with host performance counters (implies -q)\n");
+        printf("  --accelerate  Run on the packed engine, summarizing simple counted loops in closed form (implies -q)\n");
+        printf("  --shm NAME    Publish store and registers in shared memory /NAME for baby-inspect\n");
+        printf("  --tui         Live view (space: pause/run, s: step, q: quit), redrawn --fps times a second\n");
+        printf("  --batch       Run every program listed in a file (one path per line) and print a summary line each\n");
+        printf("  --cache FILE  Reuse results of identical earlier runs from a result cache file\n");
+        printf("  --cache-entries N  Records in a newly created cache file (default %d)\n", CACHE_DEFAULT_ENTRIES);
+        printf("  --cpus N      Run N CPUs sharing one store, each on its own thread (CPU i starts with A = i)\n");
+        printf("  --round-robin Q  Run the CPUs deterministically on one thread, Q instructions each in turn\n");
+        printf("  --verify E    Run the reference and engine E in lockstep and report the first divergent cycle\n");
+        printf("  --beats OP=N,...  Cost of opcodes in beats (default 4, MUL and DIV %d)\n", INSTRUCTION_BEATS + 32);
+        printf("  --beat-us X   Length of a beat in microseconds (default %.0f)\n", BEAT_MICROSECONDS);
+        printf("  --realtime    Pace the run to the original machine's speed\n");
+        printf("  --speed F     Pace the run to F times the original machine's speed (implies --realtime)\n");
+        return 1;
+    }
+
+    engine_beat_us = beat_us;
+    ResultCache cache;
+    if (cache_path && cache_open(&cache, cache_path, cache_entries) < 0) {
+        return 1;
+    }
+    if (batch) {
+        int failed = run_batch(batch, memory_size, max_cycles, cache_path ? &cache : NULL, verify);
+        if (cache_path) {
+            cache_report(&cache);
+            cache_close(&cache);
+        }
+        return failed ? 1 : 0;
+    }
+
+    initialize_computer(&computer, memory_size);
+    computer.trace = log_level >= 0 ? log_level : quiet ? LOG_SUMMARY : LOG_MICROOP;
+
+    int status;
+    if (strcmp(program, "-") == 0) {
+        status = load_program_stream(&computer, stdin, "<stdin>");
+    } else {
+        status = load_program(&computer, program);
+    }
+    if (status == 0 && shm_name) {
+        status = attach_shared_state(&computer, shm_name);
+    }
+
+    long long step = 0;
+    if (status == 0 && tui) {
+        computer.trace = LOG_OFF;
+        run_tui(&computer, fps, speed);
+    } else if (status == 0 && verify >= 0) {
+        VerifyReport report;
+        status = verify_run(&computer, verify, max_cycles > 0 ? max_cycles : LLONG_MAX, &report);
+        print_state(&computer);
+        printf("\n=== Verification ===\n");
+        verify_print(&report, verify, memory_size);
+    } else if (status == 0 && cpus > 0) {
+        run_smp(&computer, cpus, max_cycles, quantum);
+    } else if (status == 0 && (cache_path || accelerate)) {
+        int hit;
+        LoopStats loops = {0};
+        unsigned long long started = monotonic_ns();
+        long long cycles = run_cached(&computer, max_cycles, cache_path ? &cache : NULL, &hit, &loops);
+        double host_seconds = (monotonic_ns() - started) / 1e9;
+        print_state(&computer);
+        printf("\n=== Program Execution %s after %lld cycles%s ===\n",
+               computer.running ? "Stopped" : "Completed", cycles, hit ? " (cached)" : "");
+        print_timing(computer.beats, host_seconds);
+        if (!hit) {
+            print_loops(&loops, cycles);
+        }
+        if (cache_path) {
+            cache_report(&cache);
+        }
+    } else if (status == 0) {
+        if (!quiet) {
+            print_state(&computer);
+        }
+        unsigned long long started = monotonic_ns();
+        if (perf) {
+            step = run_with_perf(&computer, max_cycles, PERF_SAMPLE_PERIOD);
+        }
+        while (computer.running && (max_cycles == 0 || step < max_cycles)) {
+            step_computer(&computer, &step);
+            if (!quiet) {
+                report_state(&computer, step, full_every);
+            }
+            if (speed > 0) {
+                pace_realtime(started, computer.beats, speed);
+            }
+        }
+        double host_seconds = (monotonic_ns() - started) / 1e9;
+        if (quiet) {
+            print_state(&computer);
+        }
+        printf("\n=== Program Execution %s after %lld cycles ===\n",
+               computer.running ? "Stopped" : "Completed", step);
+        print_timing(computer.beats, host_seconds);
+    }
+
+    free_computer(&computer);
+    if (cache_path) {
+        cache_close(&cache);
+    }
+    return status == 0 ? 0 : 1;
+}
+
+// Run one fetch-decode-execute cycle
+void step_computer(BabyComputer* computer, long long* step) {
+    int opcode, operand;
+
+    TRACE(computer, LOG_MICROOP, "\n=== Cycle %lld ===\n", *step);
+    (*step)++;
+
+    TRACE(computer, LOG_MICROOP, "\n--- Fetch Stage ---\n");
+    fetch(computer);
+
+    TRACE(computer, LOG_MICROOP, "\n--- Decode Stage ---\n");
+    decode(computer, &opcode, &operand);
+
+    // Charge the instruction's cost; the initialization skip costs as much as CMP
+    computer->beats += engine_beats[computer->CI == 0 ? CMP : opcode];
+
+    TRACE(computer, LOG_MICROOP, "\n--- Execute Stage ---\n");
+    if (computer->shared) {
+        // Odd sequence: inspectors retry while the store is being changed
+        unsigned int seq = atomic_load_explicit(&computer->shared->sequence, memory_order_relaxed);
+        atomic_store_explicit(&computer->shared->sequence, seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        execute(computer, opcode, operand);
+        publish_shared_state(computer, *step);
+    } else {
+        execute(computer, opcode, operand);
+    }
+}
+
+// Publish the registers and close the seqlock write section
+void publish_shared_state(BabyComputer* computer, long long step) {
+    BabySharedState* shared = computer->shared;
+    unsigned int seq = atomic_load_explicit(&shared->sequence, memory_order_relaxed);
+    if (!(seq & 1)) {
+        atomic_store_explicit(&shared->sequence, ++seq, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+    }
+    shared->accumulator = computer->accumulator;
+    shared->CI = computer->CI;
+    shared->PI = computer->PI;
+    shared->running = computer->running;
+    shared->cycles = step;
+    atomic_store_explicit(&shared->sequence, seq + 1, memory_order_release);
+}
+
+// Move the store into a named shared-memory segment so baby-inspect can read it
+int attach_shared_state(BabyComputer* computer, const char* name) {
+    if (computer->memory_size > SHARED_STORE_WORDS) {
+        printf("Error: Store too large for a shared segment\n");
+        return -1;
+    }
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(BabySharedState)) < 0) {
+        printf("Error: Unable to create shared memory segment '%s'\n", name);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    BabySharedState* shared = mmap(NULL, sizeof(BabySharedState), PROT_READ | PROT_WRITE,
+                                   MAP_SHARED, fd, 0);
+    close(fd);
+    if (shared == MAP_FAILED) {
+        printf("Error: Unable to map shared memory segment '%s'\n", name);
+        shm_unlink(name);
+        return -1;
+    }
+
+    memset(shared, 0, sizeof(BabySharedState));
+    shared->memory_size = computer->memory_size;
+    for (int i = 0; i < computer->memory_size; i++) {
+        memcpy(shared->store[i], computer->store[i], WORD_SIZE * sizeof(int));
+        free(computer->store[i]);
+        computer->store[i] = shared->store[i];
+    }
+    computer->shared = shared;
+    computer->shared_name = strdup(name);
+    publish_shared_state(computer, 0);
+    shared->magic = SHARED_STATE_MAGIC;
+    return 0;
+}
+
+// Open one host counter for this thread (user space only); -1 if not permitted
+static int open_perf_counter(unsigned int type, unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static unsigned long long read_perf_counter(int fd) {
+    unsigned long long value = 0;
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) return 0;
+    return value;
+}
+
+// Group emulated opcodes for sampled attribution
+static int opcode_class(int opcode) {
+    switch (opcode) {
+        case JMP: case JRP: case CMP: case STP: return 0;
+        case LDN: case STO: case TAS: case LDX: return 1;
+        case SUB: case SUB2: case ADD: case MUL: case DIV: return 2;
+        default: return 3;
+    }
+}
+
+// Run to completion under host performance counters and report the cost per
+// emulated instruction. Every sample_period-th instruction is timed on its own
+// and charged to its opcode class. Without counter access, wall-clock time is
+// used instead.
+long long run_with_perf(BabyComputer* computer, long max_cycles, int sample_period) {
+    static const char* counter_names[PERF_COUNTERS] = {
+        "cycles", "instructions", "branch-misses", "L1D read misses"
+    };
+    static const char* class_names[PERF_CLASSES] = { "control", "memory", "arithmetic", "logic" };
+    int fds[PERF_COUNTERS] = {
+        open_perf_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+        open_perf_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS),
+        open_perf_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES),
+        open_perf_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)),
+    };
+    int use_cycles = fds[0] >= 0;
+    const char* sample_unit = use_cycles ? "host cycles" : "ns";
+
+    // Cost of reading the sample clock itself, subtracted from every sample
+    unsigned long long overhead = ~0ULL;
+    if (use_cycles) ioctl(fds[0], PERF_EVENT_IOC_ENABLE, 0);
+    for (int i = 0; i < 64; i++) {
+        unsigned long long a = use_cycles ? read_perf_counter(fds[0]) : monotonic_ns();
+        unsigned long long b = use_cycles ? read_perf_counter(fds[0]) : monotonic_ns();
+        if (b - a < overhead) overhead = b - a;
+    }
+
+    unsigned long long class_cost[PERF_CLASSES] = { 0 };
+    long class_samples[PERF_CLASSES] = { 0 };
+    unsigned long long totals[PERF_COUNTERS] = { 0 };
+    long long step = 0;
+
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        if (fds[c] >= 0) {
+            ioctl(fds[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    unsigned long long started = monotonic_ns();
+
+    int countdown = sample_period;
+    while (computer->running && (max_cycles == 0 || step < max_cycles)) {
+        if (--countdown > 0) {
+            step_computer(computer, &step);
+            continue;
+        }
+        countdown = sample_period;
+
+        // Peek at the opcode so the timed window holds only the instruction
+        int* word = computer->store[computer->CI];
+        int opcode = (word[13] << 3) | (word[14] << 2) | (word[15] << 1) | word[16] | (word[17] << 4);
+        unsigned long long before = use_cycles ? read_perf_counter(fds[0]) : monotonic_ns();
+        step_computer(computer, &step);
+        unsigned long long after = use_cycles ? read_perf_counter(fds[0]) : monotonic_ns();
+        int cls = opcode_class(opcode);
+        class_cost[cls] += after - before > overhead ? after - before - overhead : 0;
+        class_samples[cls]++;
+    }
+
+    unsigned long long elapsed = monotonic_ns() - started;
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        if (fds[c] >= 0) {
+            ioctl(fds[c], PERF_EVENT_IOC_DISABLE, 0);
+            totals[c] = read_perf_counter(fds[c]);
+            close(fds[c]);
+        }
+    }
+
+    printf("\n=== Performance Counters ===\n");
+    printf("Emulated instructions: %lld\n", step);
+    printf("Host time: %.6f s (%.1f ns per instruction, %.2f M instructions/s)\n",
+           elapsed / 1e9, step ? (double)elapsed / step : 0, step ? step / (elapsed / 1e3) : 0);
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        if (fds[c] < 0) {
+            printf("%-16s not available (counter access not permitted or unsupported)\n", counter_names[c]);
+        } else {
+            printf("%-16s %llu (%.2f per emulated instruction)\n", counter_names[c], totals[c],
+                   step ? (double)totals[c] / step : 0);
+        }
+    }
+    if (fds[0] >= 0 && fds[1] >= 0 && totals[0]) {
+        printf("Host IPC: %.2f\n", (double)totals[1] / totals[0]);
+    }
+
+    printf("\nSampled attribution (1 in %d instructions, %s per instruction):\n", sample_period, sample_unit);
+    long samples = 0;
+    for (int c = 0; c < PERF_CLASSES; c++) samples += class_samples[c];
+    for (int c = 0; c < PERF_CLASSES; c++) {
+        if (class_samples[c] == 0) continue;
+        printf("  %-11s %5.1f%% of instructions, %8.1f %s\n", class_names[c],
+               100.0 * class_samples[c] / samples, (double)class_cost[c] / class_samples[c], sample_unit);
+    }
+    if (samples == 0) {
+        printf("  (run too short for any samples)\n");
+    }
+    return step;
+}
+
+// Copy the machine into the session's snapshot; only the engine thread calls this
+static void tui_publish(TuiSession* session, long long step) {
+    BabyComputer* computer = session->computer;
+    int words[SHARED_STORE_WORDS];
+    for (int a = 0; a < computer->memory_size; a++) {
+        int value = 0;
+        for (int j = 0; j < WORD_SIZE; j++) {
+            value |= computer->store[a][j] << j;
+        }
+        words[a] = value;
+    }
+
+    pthread_mutex_lock(&session->lock);
+    TuiSnapshot* snapshot = &session->snapshot;
+    snapshot->cycles = step;
+    snapshot->beats = computer->beats;
+    snapshot->accumulator = computer->accumulator;
+    snapshot->CI = computer->CI;
+    snapshot->running = computer->running;
+    memcpy(snapshot->words, words, computer->memory_size * sizeof(int));
+    pthread_mutex_unlock(&session->lock);
+}
+
+// TUI engine thread: runs at full speed, checking control flags once per batch,
+// or paced to the machine time of each instruction when session->speed is set
+static void* tui_engine(void* arg) {
+    TuiSession* session = arg;
+    BabyComputer* computer = session->computer;
+    long long step = 0;
+    int paced = 0;
+    unsigned long long anchor_ns = 0;
+    long long anchor_beats = 0;
+
+    while (!atomic_load_explicit(&session->quit, memory_order_relaxed)) {
+        if (!computer->running) {
+            usleep(1000);
+            continue;
+        }
+        if (atomic_load_explicit(&session->paused, memory_order_relaxed)) {
+            paced = 0;
+            if (atomic_load_explicit(&session->step_requests, memory_order_relaxed) > 0) {
+                atomic_fetch_sub_explicit(&session->step_requests, 1, memory_order_relaxed);
+                step_computer(computer, &step);
+                tui_publish(session, step);
+            } else {
+                usleep(1000);
+            }
+            continue;
+        }
+        if (session->speed > 0) {
+            // Restart the pacing clock after a pause so paused time is not made up
+            if (!paced) {
+                anchor_ns = monotonic_ns();
+                anchor_beats = computer->beats;
+                paced = 1;
+            }
+            unsigned long long due = anchor_ns + beats_to_ns(computer->beats - anchor_beats, session->speed);
+            unsigned long long now = monotonic_ns();
+            if (due > now) {
+                usleep((useconds_t)((due - now) / 1000 < 1000 ? (due - now) / 1000 : 1000));
+                continue;
+            }
+            step_computer(computer, &step);
+            tui_publish(session, step);
+            continue;
+        }
+        for (int i = 0; i < TUI_BATCH && computer->running; i++) {
+            step_computer(computer, &step);
+        }
+        tui_publish(session, step);
+    }
+    return NULL;
+}
+
+// Draw one frame from a snapshot published by the engine thread
+static void tui_draw(TuiSession* session, const TuiSnapshot* snapshot, double cycles_per_sec) {
+    static char frame[16384];
+    int len = 0;
+    int acc = snapshot->accumulator;
+    int ci = snapshot->CI;
+    int running = snapshot->running;
+    long long beats = snapshot->beats;
+    long long cycles = snapshot->cycles;
+    int paused = atomic_load_explicit(&session->paused, memory_order_relaxed);
+
+    len += snprintf(frame + len, sizeof(frame) - len, "\033[H\033[2J=== Manchester Baby (live) ===\n");
+    len += snprintf(frame + len, sizeof(frame) - len, "%s | cycles %lld | %.0f cycles/sec | machine time %.3f s",
+                    !running ? "STOPPED" : paused ? "PAUSED" : "RUNNING", cycles, cycles_per_sec,
+                    engine_simulated_seconds(beats));
+    if (session->speed > 0) {
+        len += snprintf(frame + len, sizeof(frame) - len, " (real time x%g)", session->speed);
+    }
+    frame[len++] = '\n';
+    len += snprintf(frame + len, sizeof(frame) - len, "CI %2d   A ", ci);
+    for (int i = 0; i < WORD_SIZE; i++) frame[len++] = ((acc >> i) & 1) ? '#' : '.';
+    len += snprintf(frame + len, sizeof(frame) - len, " (%d)\n\n", acc);
+
+    for (int a = 0; a < session->computer->memory_size; a++) {
+        int value = snapshot->words[a];
+        len += snprintf(frame + len, sizeof(frame) - len, "%s%2d ", a == ci ? ">" : " ", a);
+        for (int j = 0; j < WORD_SIZE; j++) {
+            frame[len++] = ((value >> j) & 1) ? '#' : '.';
+        }
+        len += snprintf(frame + len, sizeof(frame) - len, " %d\n", value);
+    }
+    len += snprintf(frame + len, sizeof(frame) - len, "\n[space] pause/run  [s] step  [q] quit\n");
+    fwrite(frame, 1, len, stdout);
+    fflush(stdout);
+}
+
+// Live terminal UI: redraws at a fixed rate while the engine thread runs freely,
+// or at speed times the original machine's rate when speed is above 0
+int run_tui(BabyComputer* computer, int fps, double speed) {
+    TuiSession session;
+    session.computer = computer;
+    session.speed = speed;
+    pthread_mutex_init(&session.lock, NULL);
+    tui_publish(&session, 0);
+    atomic_init(&session.paused, 0);
+    atomic_init(&session.step_requests, 0);
+    atomic_init(&session.quit, 0);
+
+    // Unbuffered keys without echo so controls never block the display
+    struct termios saved, raw;
+    int has_tty = tcgetattr(STDIN_FILENO, &saved) == 0;
+    if (has_tty) {
+        raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+
+    unsigned long long started = monotonic_ns();
+    pthread_t engine;
+    if (pthread_create(&engine, NULL, tui_engine, &session) != 0) {
+        printf("Error: Unable to start the engine thread\n");
+        pthread_mutex_destroy(&session.lock);
+        if (has_tty) tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+        return -1;
     }
-    free(computer.store);
 
+    int frame_ms = 1000 / fps > 0 ? 1000 / fps : 1;
+    struct timespec last, now;
+    clock_gettime(CLOCK_MONOTONIC, &last);
+    long long last_cycles = 0;
+    double cycles_per_sec = 0;
+    TuiSnapshot snapshot;
+    int keys_open = 1;
+
+    while (1) {
+        // Once stdin reaches end of file, poll only waits out the frame
+        struct pollfd pfd = { keys_open ? STDIN_FILENO : -1, POLLIN, 0 };
+        if (poll(&pfd, 1, frame_ms) > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL))) {
+            char key;
+            if (!(pfd.revents & POLLIN) || read(STDIN_FILENO, &key, 1) <= 0) {
+                keys_open = 0;
+            } else {
+                if (key == 'q') break;
+                if (key == ' ') {
+                    atomic_store(&session.paused, !atomic_load(&session.paused));
+                } else if (key == 's') {
+                    atomic_store(&session.paused, 1);
+                    atomic_fetch_add(&session.step_requests, 1);
+                }
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsed = (now.tv_sec - last.tv_sec) + (now.tv_nsec - last.tv_nsec) / 1e9;
+        if (elapsed * 1000 < frame_ms) continue;
+
+        pthread_mutex_lock(&session.lock);
+        snapshot = session.snapshot;
+        pthread_mutex_unlock(&session.lock);
+        cycles_per_sec = (snapshot.cycles - last_cycles) / elapsed;
+        last_cycles = snapshot.cycles;
+        last = now;
+        tui_draw(&session, &snapshot, cycles_per_sec);
+    }
+
+    atomic_store(&session.quit, 1);
+    pthread_join(engine, NULL);
+    pthread_mutex_destroy(&session.lock);
+    if (has_tty) tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    printf("\n=== Program Execution %s after %lld cycles ===\n",
+           computer->running ? "Stopped" : "Completed", session.snapshot.cycles);
+    print_timing(computer->beats, (monotonic_ns() - started) / 1e9);
     return 0;
 }
 
@@ -221,9 +886,55 @@ void initialize_computer(BabyComputer* computer, int memory_size) {
     computer->CI = 0;
     computer->PI = 0;
     computer->running = 1;
+    computer->trace = LOG_MICROOP;
+    computer->dirty = 0;
+    computer->beats = 0;
     computer->addr_mode = DIRECT;
+    computer->indexed = 0;
     computer->index_reg = 0;
     computer->base_reg = 0;
+    computer->shared = NULL;
+    computer->shared_name = NULL;
+}
+
+// Reset registers and restore the store to an image, rewriting only the words
+// written since the last reset plus those flagged in changed (no reallocation)
+void reset_computer(BabyComputer* computer, const int* image, unsigned long long changed) {
+    unsigned long long restore = computer->dirty | changed;
+    while (restore) {
+        int address = __builtin_ctzll(restore);
+        restore &= restore - 1;
+        int value = image[address];
+        for (int i = 0; i < WORD_SIZE; i++) {
+            computer->store[address][i] = value & 1;
+            value >>= 1;
+        }
+    }
+    computer->dirty = 0;
+    computer->beats = 0;
+    computer->accumulator = 0;
+    computer->index_reg = 0;
+    computer->CI = 0;
+    computer->PI = 0;
+    computer->running = 1;
+    if (computer->shared) {
+        publish_shared_state(computer, 0);
+    }
+}
+
+// Release the store allocated by initialize_computer
+void free_computer(BabyComputer* computer) {
+    if (computer->shared) {
+        // Store rows live in the shared segment
+        munmap(computer->shared, sizeof(BabySharedState));
+        shm_unlink(computer->shared_name);
+        free(computer->shared_name);
+    } else {
+        for (int i = 0; i < computer->memory_size; i++) {
+            free(computer->store[i]);
+        }
+    }
+    free(computer->store);
 }
 
 // Load program from file into memory
@@ -234,10 +945,18 @@ int load_program(BabyComputer* computer, const char* filename) {
         printf("Error: File '%s' does not exist\n", filename);
         return -1;
     }
-    
-    // Then, check if it is a valid machine code file
+
+    int status = load_program_stream(computer, file, filename);
+    fclose(file);
+    return status;
+}
+
+// Validate and load machine code in a single pass, so pipes work too
+int load_program_stream(BabyComputer* computer, FILE* file, const char* name) {
     char line[WORD_SIZE + 2];  // +2 for newline and string termination
+    char* image = malloc(computer->memory_size * WORD_SIZE);
     int valid = 1;
+    int address = 0;
     
     // Check each line for valid machine code format
     while (fgets(line, sizeof(line), file)) {
@@ -258,47 +977,51 @@ int load_program(BabyComputer* computer, const char* filename) {
         }
         
         if (!valid) break;
+
+        // Keep the instruction until the whole file has been validated
+        if (address < computer->memory_size) {
+            for (int i = 0; i < WORD_SIZE; i++) {
+                image[address * WORD_SIZE + i] = line[i] - '0';
+            }
+            address++;
+        }
     }
     
     // If not a valid machine code file, return error
     if (!valid) {
-        printf("Error: File '%s' is not a valid machine code file\n", filename);
+        printf("Error: File '%s' is not a valid machine code file\n", name);
         printf("Machine code file should:\n");
         printf("1. Have exactly 32 characters per line\n");
         printf("2. Contain only 0s and 1s\n");
         printf("Please use the assembler to convert assembly code to machine code\n");
-        fclose(file);
+        free(image);
         return -1;
     }
     
-    // Rewind to start of file
-    rewind(file);
-    
     // Load program into memory
-    int address = 0;
-    while (fgets(line, sizeof(line), file) && address < computer->memory_size) {
-        line[strcspn(line, "\n")] = 0;
-        
-        // Load instruction
+    for (int a = 0; a < address; a++) {
         for (int i = 0; i < WORD_SIZE; i++) {
-            computer->store[address][i] = line[i] - '0';
+            computer->store[a][i] = image[a * WORD_SIZE + i];
         }
-        address++;
     }
     
-    printf("Successfully loaded %d instructions\n", address);
-    fclose(file);
+    TRACE(computer, LOG_SUMMARY, "Successfully loaded %d instructions\n", address);
+    LOG_FLUSH();
+    free(image);
     return 0;
 }
 
 // Fetch instruction from memory
 void fetch(BabyComputer* computer) {
-    printf("CI = %d\n", computer->CI);
-    printf("Current instruction: ");
-    for (int i = 0; i < WORD_SIZE; i++) {
-        printf("%d", computer->store[computer->CI][i]);
+    TRACE(computer, LOG_MICROOP, "CI = %d\n", computer->CI);
+    if (TRACING(computer, LOG_MICROOP)) {
+        char bits[WORD_SIZE + 1];
+        for (int i = 0; i < WORD_SIZE; i++) {
+            bits[i] = '0' + computer->store[computer->CI][i];
+        }
+        bits[WORD_SIZE] = '\0';
+        log_printf("Current instruction: %s\n", bits);
     }
-    printf("\n");
 
     // Load current instruction into PI register
     computer->PI = 0;
@@ -313,7 +1036,8 @@ void decode(BabyComputer* computer, int* opcode, int* operand) {
     *opcode = (computer->store[computer->CI][13] << 3) |  // 14th bit (least significant bit) -> 3rd bit
               (computer->store[computer->CI][14] << 2) |  // 15th bit -> 2nd bit
               (computer->store[computer->CI][15] << 1) |  // 16th bit -> 1st bit
-              (computer->store[computer->CI][16] << 0);   // 17th bit (most significant bit) -> 0th bit
+              (computer->store[computer->CI][16] << 0) |  // 17th bit (most significant bit) -> 0th bit
+              (computer->store[computer->CI][17] << 4);   // 18th bit selects the extension instructions
     
     // Get the first 13 bits as the operand (calculate from left to right)
     *operand = 0;
@@ -323,13 +1047,14 @@ void decode(BabyComputer* computer, int* opcode, int* operand) {
         }
     }
     
-    printf("\n--- Decode Stage ---\n");
-    printf("Instruction analysis:\n");
-    printf("- Opcode (14-17 bits): %d%d%d%d (%s)\n",
+    TRACE(computer, LOG_MICROOP, "\n--- Decode Stage ---\n");
+    TRACE(computer, LOG_MICROOP, "Instruction analysis:\n");
+    TRACE(computer, LOG_MICROOP, "- Opcode (14-18 bits): %d%d%d%d%d (%s)\n",
            computer->store[computer->CI][13],
            computer->store[computer->CI][14],
            computer->store[computer->CI][15],
            computer->store[computer->CI][16],
+           computer->store[computer->CI][17],
            *opcode == 0b0000 ? "JMP" :   // 0000
            *opcode == 0b1000 ? "JRP" :   // 1000
            *opcode == 0b0100 ? "LDN" :   // 0100
@@ -346,52 +1071,71 @@ void decode(BabyComputer* computer, int* opcode, int* operand) {
            *opcode == 0b1011 ? "XOR" :   // 1011
            *opcode == 0b0111 ? "SHL" :   // 0111
            *opcode == 0b1111 ? "SHR" :   // 1111
+           *opcode == 0b10000 ? "TAS" :  // 0000 + bit 18
+           *opcode == 0b10001 ? "LDX" :  // 0001 + bit 18
            "Unknown");
+
+    // Bits 19-21 select the addressing mode; instructions that do not read
+    // their operand treat an immediate operand as a direct address
+    const int* bits = computer->store[computer->CI];
+    computer->addr_mode = (AddressingMode)(bits[MODE_COLUMN] | bits[MODE_COLUMN + 1] << 1);
+    computer->indexed = bits[INDEX_COLUMN];
+    if (computer->addr_mode == IMMEDIATE && !READS_OPERAND(*opcode)) {
+        computer->addr_mode = DIRECT;
+    }
+    if (computer->addr_mode != DIRECT || computer->indexed) {
+        static const char* const modes[] = { "direct", "indirect", "immediate", "relative" };
+        TRACE(computer, LOG_MICROOP, "- Addressing mode (19-21 bits): %s%s\n",
+              modes[computer->addr_mode], computer->indexed ? ", indexed by X" : "");
+    }
     
-    printf("- Operand (first 13 bits): ");
-    // Print operand in binary (first 13 bits)
-    for (int i = 0; i < 13; i++) {
-        printf("%d", computer->store[computer->CI][i]);
+    if (TRACING(computer, LOG_MICROOP)) {
+        log_printf("- Operand (first 13 bits): ");
+        // Print operand in binary (first 13 bits)
+        log_binary(*operand, 13);
+        log_printf(" (binary) = %d (decimal)\n", *operand);
     }
-    printf(" (binary) = %d (decimal)\n", *operand);
 }
 
 // Execute instruction
 void execute(BabyComputer* computer, int opcode, int operand) {
     if (computer->CI == 0) {
-        printf("Skip initialization instruction, move to the next instruction\n");
+        TRACE(computer, LOG_INSTRUCTION, "Skip initialization instruction, move to the next instruction\n");
         computer->CI = 1;
         return;
     }
 
-    int address = operand;  // Directly use the operand as the address
+    int address = get_effective_address(computer, operand);
+    if (computer->indexed || computer->addr_mode == INDIRECT || computer->addr_mode == RELATIVE) {
+        TRACE(computer, LOG_INSTRUCTION, "Effective address: %d\n", address);
+    }
 
     switch (opcode) {
         case 0b0000: {  // JMP (0000 = 0)
-            printf("Executing: JMP - Jump to address %d\n", address);
+            TRACE(computer, LOG_INSTRUCTION, "Executing: JMP - Jump to address %d\n", address);
             computer->CI = address;
         } break;
         
         case 0b1000: {  // JRP (1000 = 1)
-            printf("Executing: JRP - Relative jump, current position %d plus offset %d\n", 
+            TRACE(computer, LOG_INSTRUCTION, "Executing: JRP - Relative jump, current position %d plus offset %d\n", 
                    computer->CI, address);
             computer->CI += address;
         } break;
         
         case 0b0100: {  // LDN (0100 = 2)
-            printf("Executing: LDN - Load from address %d ", address);
+            TRACE(computer, LOG_INSTRUCTION, "Executing: LDN - Load from address %d ", address);
             int value = get_value_from_address(computer, address);
             computer->accumulator = -value;
-            printf("negative value to the accumulator: ");
-            print_binary(computer->accumulator, WORD_SIZE);
-            printf(" (%d)\n", computer->accumulator);
+            TRACE(computer, LOG_INSTRUCTION, "negative value to the accumulator: ");
+            TRACE_BINARY(computer, LOG_INSTRUCTION, computer->accumulator, WORD_SIZE);
+            TRACE(computer, LOG_INSTRUCTION, " (%d)\n", computer->accumulator);
             computer->CI++;
         } break;
         
         case 0b1100: {  // STO (1100 = 3)
-            printf("Executing: STO - Store accumulator value ");
-            print_binary(computer->accumulator, WORD_SIZE);
-            printf(" (%d) to address %d\n", computer->accumulator, address);
+            TRACE(computer, LOG_INSTRUCTION, "Executing: STO - Store accumulator value ");
+            TRACE_BINARY(computer, LOG_INSTRUCTION, computer->accumulator, WORD_SIZE);
+            TRACE(computer, LOG_INSTRUCTION, " (%d) to address %d\n", computer->accumulator, address);
             store_value_to_address(computer, address, computer->accumulator);
             computer->CI++;
         } break;
@@ -401,30 +1145,30 @@ void execute(BabyComputer* computer, int opcode, int operand) {
             int value = get_value_from_address(computer, address);
             int old_acc = computer->accumulator;
             computer->accumulator -= value;
-            printf("Executing: SUB - Subtract from accumulator ");
-            print_binary(old_acc, WORD_SIZE);
-            printf(" (%d) the value at address %d ", old_acc, address);
-            print_binary(value, WORD_SIZE);
-            printf(" (%d), result: ", value);
-            print_binary(computer->accumulator, WORD_SIZE);
-            printf(" (%d)\n", computer->accumulator);
-            printf("Executing: SUB - Calculation: %d - %d = %d\n", 
+            TRACE(computer, LOG_INSTRUCTION, "Executing: SUB - Subtract from accumulator ");
+            TRACE_BINARY(computer, LOG_INSTRUCTION, old_acc, WORD_SIZE);
+            TRACE(computer, LOG_INSTRUCTION, " (%d) the value at address %d ", old_acc, address);
+            TRACE_BINARY(computer, LOG_INSTRUCTION, value, WORD_SIZE);
+            TRACE(computer, LOG_INSTRUCTION, " (%d), result: ", value);
+            TRACE_BINARY(computer, LOG_INSTRUCTION, computer->accumulator, WORD_SIZE);
+            TRACE(computer, LOG_INSTRUCTION, " (%d)\n", computer->accumulator);
+            TRACE(computer, LOG_INSTRUCTION, "Executing: SUB - Calculation: %d - %d = %d\n", 
                    old_acc, value, computer->accumulator);
             computer->CI++;
         } break;
         
         case 0b0110: {  // CMP (0110 = 6)
             int value = get_value_from_address(computer, address);
-            printf("Executing: CMP - Compare accumulator ");
-            print_binary(computer->accumulator, WORD_SIZE);
-            printf(" (%d) with the value at address %d ", computer->accumulator, address);
-            print_binary(value, WORD_SIZE);
-            printf(" (%d)\n", value);
+            TRACE(computer, LOG_INSTRUCTION, "Executing: CMP - Compare accumulator ");
+            TRACE_BINARY(computer, LOG_INSTRUCTION, computer->accumulator, WORD_SIZE);
+            TRACE(computer, LOG_INSTRUCTION, " (%d) with the value at address %d ", computer->accumulator, address);
+            TRACE_BINARY(computer, LOG_INSTRUCTION, value, WORD_SIZE);
+            TRACE(computer, LOG_INSTRUCTION, " (%d)\n", value);
             computer->CI++;
         } break;
         
         case 0b1110: {  // STP (1110 = 7)
-            printf("Executing: STP - Program stop\n");
+            TRACE(computer, LOG_INSTRUCTION, "Executing: STP - Program stop\n");
             computer->running = 0;
         } break;
 
@@ -432,7 +1176,7 @@ void execute(BabyComputer* computer, int opcode, int operand) {
             int value = get_value_from_address(computer, address);
             int old_acc = computer->accumulator;
             computer->accumulator += value;
-            printf("Executing: ADD - Calculation: %d + %d = %d\n", 
+            TRACE(computer, LOG_INSTRUCTION, "Executing: ADD - Calculation: %d + %d = %d\n", 
                    old_acc, value, computer->accumulator);
             computer->CI++;
         } break;
@@ -441,7 +1185,7 @@ void execute(BabyComputer* computer, int opcode, int operand) {
             int value = get_value_from_address(computer, address);
             int old_acc = computer->accumulator;
             computer->accumulator *= value;
-            printf("Executing: MUL - Calculation: %d * %d = %d\n", 
+            TRACE(computer, LOG_INSTRUCTION, "Executing: MUL - Calculation: %d * %d = %d\n", 
                    old_acc, value, computer->accumulator);
             computer->CI++;
         } break;
@@ -450,11 +1194,16 @@ void execute(BabyComputer* computer, int opcode, int operand) {
             int value = get_value_from_address(computer, address);
             if (value != 0) {
                 int old_acc = computer->accumulator;
-                computer->accumulator /= value;
-                printf("Executing: DIV - Calculation: %d / %d = %d\n", 
+                if (value == -1) {
+                    // INT_MIN / -1 overflows and traps; negate with wraparound instead
+                    computer->accumulator = (int)(0u - (unsigned int)computer->accumulator);
+                } else {
+                    computer->accumulator /= value;
+                }
+                TRACE(computer, LOG_INSTRUCTION, "Executing: DIV - Calculation: %d / %d = %d\n", 
                        old_acc, value, computer->accumulator);
             } else {
-                printf("Error: Division by zero\n");
+                TRACE(computer, LOG_INSTRUCTION, "Error: Division by zero\n");
             }
             computer->CI++;
         } break;
@@ -463,7 +1212,7 @@ void execute(BabyComputer* computer, int opcode, int operand) {
             int value = get_value_from_address(computer, address);
             int old_acc = computer->accumulator;
             computer->accumulator &= value;
-            printf("Executing: AND - Calculation: %d & %d = %d\n", 
+            TRACE(computer, LOG_INSTRUCTION, "Executing: AND - Calculation: %d & %d = %d\n", 
                    old_acc, value, computer->accumulator);
             computer->CI++;
         } break;
@@ -472,7 +1221,7 @@ void execute(BabyComputer* computer, int opcode, int operand) {
             int value = get_value_from_address(computer, address);
             int old_acc = computer->accumulator;
             computer->accumulator |= value;
-            printf("Executing: OR - Calculation: %d | %d = %d\n", 
+            TRACE(computer, LOG_INSTRUCTION, "Executing: OR - Calculation: %d | %d = %d\n", 
                    old_acc, value, computer->accumulator);
             computer->CI++;
         } break;
@@ -481,7 +1230,7 @@ void execute(BabyComputer* computer, int opcode, int operand) {
             int value = get_value_from_address(computer, address);
             int old_acc = computer->accumulator;
             computer->accumulator ^= value;
-            printf("Executing: XOR - Calculation: %d ^ %d = %d\n", 
+            TRACE(computer, LOG_INSTRUCTION, "Executing: XOR - Calculation: %d ^ %d = %d\n", 
                    old_acc, value, computer->accumulator);
             computer->CI++;
         } break;
@@ -489,8 +1238,11 @@ void execute(BabyComputer* computer, int opcode, int operand) {
         case 0b0111: {  // SHL
             int value = get_value_from_address(computer, address);
             int old_acc = computer->accumulator;
-            computer->accumulator <<= value;
-            printf("Executing: SHL - Calculation: %d << %d = %d\n", 
+            // Counts of 32 or more (negative ones included) shift every bit out
+            // instead of being masked by the host
+            computer->accumulator = (unsigned int)value >= WORD_SIZE ? 0 :
+                                    (int)((unsigned int)computer->accumulator << value);
+            TRACE(computer, LOG_INSTRUCTION, "Executing: SHL - Calculation: %d << %d = %d\n", 
                    old_acc, value, computer->accumulator);
             computer->CI++;
         } break;
@@ -498,25 +1250,45 @@ void execute(BabyComputer* computer, int opcode, int operand) {
         case 0b1111: {  // SHR
             int value = get_value_from_address(computer, address);
             int old_acc = computer->accumulator;
-            computer->accumulator >>= value;
-            printf("Executing: SHR - Calculation: %d >> %d = %d\n", 
+            computer->accumulator >>= (unsigned int)value >= WORD_SIZE ? WORD_SIZE - 1 : value;
+            TRACE(computer, LOG_INSTRUCTION, "Executing: SHR - Calculation: %d >> %d = %d\n", 
                    old_acc, value, computer->accumulator);
             computer->CI++;
         } break;
         
+        case 0b10000: {  // TAS
+            int value = get_value_from_address(computer, address);
+            store_value_to_address(computer, address, 1);
+            computer->accumulator = value;
+            TRACE(computer, LOG_INSTRUCTION, "Executing: TAS - Test and set address %d: was %d%s\n", address, value,
+                   value == 0 ? ", acquired (skip next instruction)" : "");
+            computer->CI += value == 0 ? 2 : 1;
+        } break;
+
+        case 0b10001: {  // LDX
+            int value = get_value_from_address(computer, address);
+            computer->index_reg = value;
+            TRACE(computer, LOG_INSTRUCTION, "Executing: LDX - Load index register X = %d\n", value);
+            computer->CI++;
+        } break;
+
         default:
-            printf("Unknown instruction: %d\n", opcode);
+            TRACE(computer, LOG_INSTRUCTION, "Unknown instruction: %d\n", opcode);
             computer->CI++;
             break;
     }
 
-    printf("Post-execution state: CI=%d, A=", computer->CI);
-    print_binary(computer->accumulator, WORD_SIZE);
-    printf(" (%d)\n", computer->accumulator);
+    // Jumps may target any 13-bit address; keep the next fetch inside the store
+    computer->CI %= computer->memory_size;
+
+    TRACE(computer, LOG_MICROOP, "Post-execution state: CI=%d, A=", computer->CI);
+    TRACE_BINARY(computer, LOG_MICROOP, computer->accumulator, WORD_SIZE);
+    TRACE(computer, LOG_MICROOP, " (%d)\n", computer->accumulator);
 }
 
 // Print computer state
 void print_state(BabyComputer* computer) {
+    LOG_FLUSH();
     printf("\n=== Computer State ===\n");
     printf("Program Counter (CI): %d\n", computer->CI);
     printf("Present Instruction (PI): ");
@@ -525,24 +1297,56 @@ void print_state(BabyComputer* computer) {
     printf("Accumulator (A): ");
     print_binary(computer->accumulator, WORD_SIZE);
     printf(" (%d)\n", computer->accumulator);
+    printf("Index Register (X): %d\n", computer->index_reg);
     
     printf("\nMemory Contents:\n");
     for (int i = 0; i < computer->memory_size; i++) {
-        printf("%2d: ", i);
-        // Print binary first
-        for (int j = 0; j < WORD_SIZE; j++) {
-            printf("%d", computer->store[i][j]);
+        print_store_word(computer, i);
+    }
+    computer->dirty = 0;
+}
+
+// Print only what changed since the last report: registers and written words
+void print_state_delta(BabyComputer* computer) {
+    printf("\n=== State Changes ===\n");
+    printf("CI: %d, A: ", computer->CI);
+    print_binary(computer->accumulator, WORD_SIZE);
+    printf(" (%d)\n", computer->accumulator);
+
+    for (int i = 0; i < computer->memory_size; i++) {
+        if (computer->dirty & (1ULL << i)) {
+            print_store_word(computer, i);
         }
-        
-        // Read from left to right, the leftmost is the least significant bit
-        int value = 0;
-        for (int j = 0; j < WORD_SIZE; j++) {
-            if (computer->store[i][j]) {
-                value |= (1 << j);  // Set the j-th bit to 1
-            }
+    }
+    computer->dirty = 0;
+}
+
+// Report state after a cycle: a full dump every full_every cycles, otherwise the changes
+void report_state(BabyComputer* computer, long long step, int full_every) {
+    LOG_FLUSH();
+    if (full_every > 0 && step % full_every == 0) {
+        print_state(computer);
+    } else {
+        print_state_delta(computer);
+    }
+}
+
+// Print one store line in binary and decimal
+void print_store_word(BabyComputer* computer, int address) {
+    printf("%2d: ", address);
+    // Print binary first
+    for (int j = 0; j < WORD_SIZE; j++) {
+        printf("%d", computer->store[address][j]);
+    }
+    
+    // Read from left to right, the leftmost is the least significant bit
+    int value = 0;
+    for (int j = 0; j < WORD_SIZE; j++) {
+        if (computer->store[address][j]) {
+            value |= (1 << j);  // Set the j-th bit to 1
         }
-        printf(" (%d)\n", value);
     }
+    printf(" (%d)\n", value);
 }
 
 // Binary to decimal
@@ -571,30 +1375,38 @@ void print_binary(int value, int width) {
     }
 }
 
-// Addressing mode handling function
+// Addressing mode handling function: the index register is added to the operand
+// first (in 32-bit wraparound arithmetic) when the instruction is indexed
 int get_effective_address(BabyComputer* computer, int operand) {
+    unsigned int size = (unsigned int)computer->memory_size;
+    unsigned int target = (unsigned int)operand;
+    if (computer->indexed) {
+        target += (unsigned int)computer->index_reg;
+    }
+
     switch (computer->addr_mode) {
         case DIRECT:
-            return operand % computer->memory_size;
+            return (int)(target % size);
             
         case INDIRECT:
             {
-                int indirect_addr = operand % computer->memory_size;
+                // The pointer word's operand field holds the address
+                int indirect_addr = (int)(target % size);
                 int final_addr = 0;
-                for (int i = 0; i < WORD_SIZE; i++) {
-                    final_addr = (final_addr << 1) | computer->store[indirect_addr][i];
+                for (int i = 0; i < 13; i++) {
+                    final_addr |= computer->store[indirect_addr][i] << i;
                 }
                 return final_addr % computer->memory_size;
             }
             
         case IMMEDIATE:
-            return operand;  // Immediate addressing directly returns the operand
+            return (int)target;  // Immediate addressing directly returns the operand
             
         case RELATIVE:
-            return (computer->CI + operand) % computer->memory_size;
+            return (int)(((unsigned int)computer->CI + target) % size);
             
         default:
-            return operand % computer->memory_size;
+            return (int)(target % size);
     }
 }
 
@@ -614,24 +1426,25 @@ int get_value_from_address(BabyComputer* computer, int address) {
         }
     }
     
-    printf("Reading value from address %d: ", address);
-    for (int i = 0; i < WORD_SIZE; i++) {
-        printf("%d", computer->store[address][i]);
-    }
-    printf(" (%d)\n", value);
-    
-    // When displaying, also read from left to right
-    printf("Loading value ");
-    for (int i = 0; i < WORD_SIZE; i++) {
-        printf("%d", computer->store[address][i]);
+    if (TRACING(computer, LOG_MICROOP)) {
+        // When displaying, also read from left to right
+        log_printf("Reading value from address %d: ", address);
+        log_binary(value, WORD_SIZE);
+        log_printf(" (%d)\n", value);
+        log_printf("Loading value ");
+        log_binary(value, WORD_SIZE);
+        log_printf(" (%d)", value);
     }
-    printf(" (%d)", value);
     
     return value;
 }
 
 // Store value to address
 void store_value_to_address(BabyComputer* computer, int address, int value) {
+    // Ensure the address is within the valid range
+    address = address % computer->memory_size;
+    computer->dirty |= 1ULL << address;
+
     // Store from left to right, consistent with other numbers
     for (int i = 0; i < WORD_SIZE; i++) {
         computer->store[address][i] = value & 1;
@@ -0,0 +1,156 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "log.h"
+
+#define WORD_SIZE 32
+#ifndef MEMORY_SIZE
+#define MEMORY_SIZE 32  // Default memory size
+#endif
+
+// Extended instruction set
+typedef enum {
+    // Basic instructions (3-bit opcode -> 4-bit opcode, leftmost is the least significant bit)
+    JMP = 0b0000,    // 0000 = 0, Jump to specified address
+    JRP = 0b1000,    // 1000 = 1, Relative jump from current position
+    LDN = 0b0100,    // 0100 = 2, Load negative value from memory
+    STO = 0b1100,    // 1100 = 3, Store accumulator value to memory
+    SUB = 0b0010,    // 0010 = 4, Subtract value from accumulator
+    SUB2 = 0b1010,   // 1010 = 5, Alternative subtraction
+    CMP = 0b0110,    // 0110 = 6, Compare values
+    STP = 0b1110,    // 1110 = 7, Stop program execution
+    // Extended arithmetic and bitwise operations
+    ADD = 0b0001,    // 0001 = 8, Add value to accumulator
+    MUL = 0b1001,    // 1001 = 9, Multiply accumulator by value
+    DIV = 0b0101,    // 0101 = 10, Divide accumulator by value
+    AND = 0b1101,    // 1101 = 11, Bitwise AND operation
+    OR  = 0b0011,    // 0011 = 12, Bitwise OR operation
+    XOR = 0b1011,    // 1011 = 13, Bitwise XOR operation
+    SHL = 0b0111,    // 0111 = 14, Shift left operation
+    SHR = 0b1111,    // 1111 = 15, Shift right operation
+    // Extension instructions: the 18th bit is set and the 4-bit opcode selects the operation
+    TAS = 0b10000,   // 0000 + bit 18 = 16, Atomic test-and-set; skips the next instruction if the word was 0
+    LDX = 0b10001    // 0001 + bit 18 = 17, Load the index register
+} OpCode;
+
+// Whether an opcode reads its operand word; the others treat IMMEDIATE as DIRECT
+#define READS_OPERAND(opcode) \
+    ((opcode) != JMP && (opcode) != JRP && (opcode) != STO && (opcode) != STP && (opcode) != TAS)
+
+// Extended addressing mode
+typedef enum {
+    DIRECT = 0,     // Direct addressing
+    INDIRECT = 1,   // Indirect addressing
+    IMMEDIATE = 2,  // Immediate addressing
+    RELATIVE = 3    // Relative addressing
+} AddressingMode;
+
+// Instruction bits selecting the addressing mode: store columns 18-19 hold the
+// AddressingMode and column 20 adds the index register to the operand
+#define MODE_COLUMN 18
+#define INDEX_COLUMN 20
+
+// Identifies a shared-memory segment published by the simulator
+#define SHARED_STATE_MAGIC 0x42414259  // "BABY"
+// Largest store a shared segment can hold
+#define SHARED_STORE_WORDS 64
+
+// Machine state published in a POSIX shared-memory segment for live inspection.
+// The store lives here directly; registers are republished every cycle under
+// a seqlock (sequence is odd while a cycle is in progress).
+typedef struct {
+    unsigned int magic;         // SHARED_STATE_MAGIC once the segment is initialised
+    int memory_size;            // Words in use in store
+    atomic_uint sequence;       // Seqlock sequence number
+    int accumulator;            // Accumulator register
+    int CI;                     // Control Instruction (Program Counter)
+    int PI;                     // Present Instruction register
+    int running;                // Program execution state
+    long long cycles;           // Cycles executed so far
+    int store[SHARED_STORE_WORDS][WORD_SIZE];  // The machine's store
+} BabySharedState;
+
+// Hardware components simulation
+typedef struct {
+    int** store;                // Dynamic memory array
+    int memory_size;            // Current memory size configuration
+    int accumulator;            // Accumulator register
+    int CI;                     // Control Instruction (Program Counter)
+    int PI;                     // Present Instruction register
+    int running;                // Program execution state
+    int trace;                  // Log level of execution details (LogLevel)
+    unsigned long long dirty;   // Bit i set when store word i was written since the last report
+    long long beats;            // Simulated machine time in beats (see engine_beats)
+    AddressingMode addr_mode;   // Addressing mode of the current instruction
+    int indexed;                // Current instruction adds index_reg to its operand
+    int index_reg;              // Index register for address calculation (X, set by LDX)
+    int base_reg;               // Base register for address calculation
+    BabySharedState* shared;    // Shared-memory segment, NULL when not published
+    char* shared_name;          // Name of the shared-memory segment
+} BabyComputer;
+
+// Host counters collected by --perf, and the emulated opcode classes they are split by
+#define PERF_COUNTERS 4
+#define PERF_CLASSES 4
+// One in this many emulated instructions is timed individually by --perf
+#define PERF_SAMPLE_PERIOD 1024
+
+// Execution details are logged when the machine's trace level includes their level
+#define TRACING(computer, level) LOG_ENABLED((computer)->trace, level)
+#define TRACE(computer, level, ...) LOG_AT((computer)->trace, level, __VA_ARGS__)
+#define TRACE_BINARY(computer, level, value, width) LOG_BINARY_AT((computer)->trace, level, value, width)
+
+// Cycles the TUI engine runs between checks of its control flags
+#define TUI_BATCH 4096
+
+// Machine state the TUI engine thread publishes for drawing
+typedef struct {
+    long long cycles;           // Cycles executed so far
+    long long beats;            // Simulated machine time in beats
+    int accumulator;            // Accumulator register
+    int CI;                     // Control Instruction (Program Counter)
+    int running;                // Program execution state
+    int words[SHARED_STORE_WORDS];  // Store, bit j = store column j
+} TuiSnapshot;
+
+// Shared state between the live TUI and its engine thread
+typedef struct {
+    BabyComputer* computer;     // Machine owned by the engine thread
+    pthread_mutex_t lock;       // Guards snapshot
+    TuiSnapshot snapshot;       // Copy of the machine taken at the last batch boundary
+    atomic_int paused;          // Engine only runs requested steps while set
+    atomic_int step_requests;   // Single steps requested while paused
+    atomic_int quit;            // Ask the engine thread to exit
+    double speed;               // Real-time pacing at this multiple of the original speed, 0 for none
+} TuiSession;
+
+// Function declarations
+void initialize_computer(BabyComputer* computer, int memory_size);
+void free_computer(BabyComputer* computer);
+void reset_computer(BabyComputer* computer, const int* image, unsigned long long changed);
+int attach_shared_state(BabyComputer* computer, const char* name);
+void publish_shared_state(BabyComputer* computer, long long step);
+int load_program(BabyComputer* computer, const char* filename);
+int load_program_stream(BabyComputer* computer, FILE* file, const char* name);
+void step_computer(BabyComputer* computer, long long* step);
+int run_headless(int argc, char* argv[]);
+int run_tui(BabyComputer* computer, int fps, double speed);
+long long run_with_perf(BabyComputer* computer, long max_cycles, int sample_period);
+void fetch(BabyComputer* computer);
+void decode(BabyComputer* computer, int* opcode, int* operand);
+void execute(BabyComputer* computer, int opcode, int operand);
+void print_state(BabyComputer* computer);
+void print_state_delta(BabyComputer* computer);
+void report_state(BabyComputer* computer, long long step, int full_every);
+void print_store_word(BabyComputer* computer, int address);
+int convert_to_decimal(int binary[], int size);
+void convert_to_binary(int decimal, int binary[], int size);
+void print_binary(int value, int width);
+int get_effective_address(BabyComputer* computer, int operand);
+int get_value_from_address(BabyComputer* computer, int address);
+void store_value_to_address(BabyComputer* computer, int address, int value);
+
+#endif
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include "smp.h"
+
+// Arguments of one CPU's host thread
+typedef struct {
+    SmpMachine* smp;            // Machine whose store is shared
+    int id;                     // CPU run by this thread
+    long long budget;           // Cycle budget of the CPU
+    pthread_barrier_t* start;   // Releases all CPUs at once
+} SmpThread;
+
+static double smp_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Give every CPU the image's store and registers; CPU i starts with A = i
+void smp_init(SmpMachine* smp, const PackedMachine* image, int cpu_count) {
+    memset(smp, 0, sizeof(*smp));
+    smp->memory_size = image->memory_size;
+    smp->cpu_count = cpu_count;
+    memcpy(smp->words, image->words, image->memory_size * sizeof(uint32_t));
+    for (int i = 0; i < cpu_count; i++) {
+        SmpCpu* cpu = &smp->cpus[i];
+        cpu->accumulator = i;
+        cpu->CI = image->CI;
+        cpu->index = image->index;
+        cpu->running = 1;
+        cpu->beats = image->beats;
+        memcpy(cpu->seen, image->words, image->memory_size * sizeof(uint32_t));
+        memcpy(cpu->decoded, image->decoded, image->memory_size * sizeof(DecodedWord));
+    }
+}
+
+// Execute one instruction on one CPU, with the semantics of execute()
+static inline void smp_step(uint32_t* words, int size, SmpCpu* cpu) {
+    int ci = cpu->CI;
+    uint32_t word = __atomic_load_n(&words[ci], __ATOMIC_ACQUIRE);
+    cpu->cycles++;
+    cpu->PI = word;
+    if (ci == 0) {
+        cpu->beats += engine_beats[CMP];
+        cpu->CI = 1;
+        return;
+    }
+    if (word != cpu->seen[ci]) {
+        // Another CPU (or this one) rewrote the word since it was decoded
+        cpu->seen[ci] = word;
+        cpu->decoded[ci] = engine_decode(word, ci, size);
+    }
+
+    DecodedWord instruction = cpu->decoded[ci];
+    cpu->beats += instruction.beats;
+    uint32_t address = instruction.address;
+    if (instruction.mode != DIRECT) {
+        address = engine_effective(instruction, (uint32_t)cpu->index, words, size);
+    }
+    uint32_t acc = (uint32_t)cpu->accumulator;
+    if ((instruction.mode & ENGINE_MODE_MASK) == IMMEDIATE) {
+        // Only instructions that read their operand are decoded as IMMEDIATE
+        if (instruction.opcode == LDX) {
+            cpu->index = (int32_t)address;
+        } else {
+            acc = engine_alu(instruction.opcode, acc, address);
+        }
+        cpu->accumulator = (int32_t)acc;
+        cpu->CI = ++ci == size ? 0 : ci;
+        return;
+    }
+    uint32_t* operand = &words[address];
+    switch (instruction.opcode) {
+        case JMP:
+            cpu->CI = (int)address;
+            return;
+        case JRP:
+            ci += (int)address;
+            cpu->CI = ci >= size ? ci - size : ci;
+            return;
+        case STP:
+            cpu->running = 0;
+            return;
+        case CMP:
+            break;
+        case STO:
+            __atomic_store_n(operand, acc, __ATOMIC_RELEASE);
+            cpu->stores++;
+            break;
+        case TAS: {
+            uint32_t value = __atomic_exchange_n(operand, 1, __ATOMIC_SEQ_CST);
+            cpu->tas++;
+            acc = value;
+            if (value != 0) {
+                cpu->tas_busy++;
+            } else if (++ci == size) {
+                ci = 0;
+            }
+        } break;
+        case LDX:
+            cpu->index = (int32_t)__atomic_load_n(operand, __ATOMIC_ACQUIRE);
+            cpu->loads++;
+            break;
+        default:
+            acc = engine_alu(instruction.opcode, acc, __atomic_load_n(operand, __ATOMIC_ACQUIRE));
+            cpu->loads++;
+            break;
+    }
+    cpu->accumulator = (int32_t)acc;
+    cpu->CI = ++ci == size ? 0 : ci;
+}
+
+// Host thread of one CPU: runs a private copy of the context so CPUs never
+// share a cache line except through the store itself
+static void* smp_thread(void* arg) {
+    SmpThread* thread = arg;
+    SmpMachine* smp = thread->smp;
+    SmpCpu cpu = smp->cpus[thread->id];
+
+    pthread_barrier_wait(thread->start);
+    double start = smp_seconds();
+    while (cpu.running && cpu.cycles < thread->budget) {
+        smp_step(smp->words, smp->memory_size, &cpu);
+    }
+    cpu.seconds = smp_seconds() - start;
+    smp->cpus[thread->id] = cpu;
+    return NULL;
+}
+
+// Free-running mode: every CPU on its own host thread until STP or the budget
+void smp_run_threads(SmpMachine* smp, long long budget) {
+    pthread_t threads[SMP_MAX_CPUS];
+    SmpThread args[SMP_MAX_CPUS];
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, smp->cpu_count);
+    for (int i = 0; i < smp->cpu_count; i++) {
+        args[i] = (SmpThread){ .smp = smp, .id = i, .budget = budget, .start = &start };
+        pthread_create(&threads[i], NULL, smp_thread, &args[i]);
+    }
+    for (int i = 0; i < smp->cpu_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&start);
+}
+
+// Deterministic mode: one host thread runs quantum instructions of each CPU in turn
+void smp_run_round_robin(SmpMachine* smp, long long budget, int quantum) {
+    int active = 1;
+    while (active) {
+        active = 0;
+        for (int i = 0; i < smp->cpu_count; i++) {
+            SmpCpu* cpu = &smp->cpus[i];
+            for (int q = 0; q < quantum && cpu->running && cpu->cycles < budget; q++) {
+                smp_step(smp->words, smp->memory_size, cpu);
+            }
+            active |= cpu->running && cpu->cycles < budget;
+        }
+    }
+}
+
+// Copy the shared store, and CPU 0's registers, into a reference machine
+void smp_to_computer(const SmpMachine* smp, BabyComputer* computer) {
+    for (int a = 0; a < smp->memory_size; a++) {
+        for (int i = 0; i < WORD_SIZE; i++) {
+            computer->store[a][i] = (smp->words[a] >> i) & 1;
+        }
+    }
+    computer->accumulator = smp->cpus[0].accumulator;
+    computer->CI = smp->cpus[0].CI;
+    computer->index_reg = smp->cpus[0].index;
+    computer->running = smp->cpus[0].running;
+}
+
+// Print per-CPU registers and statistics
+void smp_report(const SmpMachine* smp, double seconds) {
+    long long total = 0, beats = 0;
+    printf("\n=== CPU Statistics ===\n");
+    printf("CPU  CI            A        cycles         loads        stores           TAS     TAS busy\n");
+    for (int i = 0; i < smp->cpu_count; i++) {
+        const SmpCpu* cpu = &smp->cpus[i];
+        printf("%3d %3d %12d %13lld %13lld %13lld %13lld %12lld  %s\n", i, cpu->CI, cpu->accumulator,
+               cpu->cycles, cpu->loads, cpu->stores, cpu->tas, cpu->tas_busy,
+               cpu->running ? "running" : "stopped");
+        total += cpu->cycles;
+        if (cpu->beats > beats) beats = cpu->beats;
+    }
+    printf("Total %lld cycles in %.3f s host time (%.1f million instructions/s)\n",
+           total, seconds, seconds > 0 ? total / seconds / 1e6 : 0.0);
+    printf("Machine time: %.6f s (%lld beats on the slowest CPU)\n", engine_simulated_seconds(beats), beats);
+}
+
+// SMP mode: run a loaded program on cpu_count CPUs sharing its store, either
+// on host threads (quantum 0) or round-robin on this thread
+int run_smp(BabyComputer* computer, int cpu_count, long max_cycles, int quantum) {
+    static SmpMachine smp;
+    PackedMachine image;
+    engine_from_computer(&image, computer);
+    smp_init(&smp, &image, cpu_count);
+
+    long long budget = max_cycles > 0 ? max_cycles : LLONG_MAX;
+    double start = smp_seconds();
+    if (quantum > 0) {
+        smp_run_round_robin(&smp, budget, quantum);
+    } else {
+        smp_run_threads(&smp, budget);
+    }
+    double seconds = smp_seconds() - start;
+
+    smp_to_computer(&smp, computer);
+    smp_report(&smp, seconds);
+    printf("\nMemory Contents:\n");
+    for (int i = 0; i < computer->memory_size; i++) {
+        print_store_word(computer, i);
+    }
+
+    int running = 0;
+    long long total = 0;
+    for (int i = 0; i < cpu_count; i++) {
+        running += smp.cpus[i].running;
+        total += smp.cpus[i].cycles;
+    }
+    printf("\n=== SMP Execution %s after %lld cycles on %d CPUs%s ===\n",
+           running ? "Stopped" : "Completed", total, cpu_count,
+           quantum > 0 ? " (round-robin)" : "");
+    return 0;
+}
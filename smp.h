@@ -0,0 +1,48 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include "engine.h"
+
+// Most CPUs an SMP machine can have
+#define SMP_MAX_CPUS 16
+
+// One CPU context and its statistics. Each CPU keeps its own decoded copy of
+// the store and re-decodes a word only when the fetched value differs.
+typedef struct {
+    int32_t accumulator;        // Accumulator register
+    int CI;                     // Control Instruction (Program Counter)
+    uint32_t PI;                // Last fetched word, in store bit order
+    int32_t index;              // Index register X
+    int running;                // Cleared by STP
+    long long cycles;           // Instructions executed
+    long long beats;            // Simulated machine time in beats
+    long long loads;            // Operand words read
+    long long stores;           // STO instructions
+    long long tas;              // TAS instructions
+    long long tas_busy;         // TAS that found the word already set
+    double seconds;             // Host time on its thread (threaded mode)
+    uint32_t seen[ENGINE_MAX_WORDS];          // Word values behind decoded
+    DecodedWord decoded[ENGINE_MAX_WORDS];    // Private decode cache
+} SmpCpu;
+
+// Several CPUs sharing one packed store.
+// Memory ordering: every access is a single atomic word access; operand and
+// instruction fetches are acquire loads, STO is a release store and TAS is a
+// sequentially consistent exchange, so a TAS lock released by STO orders the
+// accesses made while it was held.
+typedef struct {
+    uint32_t words[ENGINE_MAX_WORDS];         // Shared store, bit j = store column j
+    int memory_size;            // Words in use
+    int cpu_count;              // CPUs in use
+    SmpCpu cpus[SMP_MAX_CPUS];  // CPU contexts; CPU i starts at CI 0 with A = i
+} SmpMachine;
+
+// Function declarations
+void smp_init(SmpMachine* smp, const PackedMachine* image, int cpu_count);
+void smp_run_threads(SmpMachine* smp, long long budget);
+void smp_run_round_robin(SmpMachine* smp, long long budget, int quantum);
+void smp_to_computer(const SmpMachine* smp, BabyComputer* computer);
+void smp_report(const SmpMachine* smp, double seconds);
+int run_smp(BabyComputer* computer, int cpu_count, long max_cycles, int quantum);
+
+#endif
@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include "verify.h"
+#include "smp.h"
+#include "loop.h"
+
+// Engine under test and its machine
+typedef struct {
+    VerifyEngine kind;          // Which engine runs
+    PackedMachine packed;       // Machine of VERIFY_PACKED and VERIFY_LOOP
+    SmpMachine* smp;            // Machine of VERIFY_SMP (CPU 0 only)
+} FastEngine;
+
+// Name of an engine from its --verify name; -1 if unknown
+int verify_parse_engine(const char* name) {
+    if (strcmp(name, "packed") == 0) return VERIFY_PACKED;
+    if (strcmp(name, "smp") == 0) return VERIFY_SMP;
+    if (strcmp(name, "loop") == 0) return VERIFY_LOOP;
+    return -1;
+}
+
+// Name of an engine as given to --verify
+const char* verify_engine_name(VerifyEngine engine) {
+    return engine == VERIFY_SMP ? "smp" : engine == VERIFY_LOOP ? "loop" : "packed";
+}
+
+// Put the engine in the state of an image
+static void fast_reset(FastEngine* fast, const PackedMachine* image) {
+    if (fast->kind == VERIFY_SMP) {
+        smp_init(fast->smp, image, 1);
+        SmpCpu* cpu = &fast->smp->cpus[0];
+        cpu->accumulator = image->accumulator;
+        cpu->PI = image->PI;
+        cpu->running = image->running;
+    } else {
+        fast->packed = *image;
+        fast->packed.cycles = 0;
+    }
+}
+
+// Advance the engine by up to cycles cycles; returns the cycles it ran
+static long long fast_run(FastEngine* fast, long long cycles) {
+    if (fast->kind == VERIFY_SMP) {
+        SmpCpu* cpu = &fast->smp->cpus[0];
+        long long before = cpu->cycles;
+        smp_run_round_robin(fast->smp, cpu->cycles + cycles, cycles < INT_MAX ? (int)cycles : INT_MAX);
+        return cpu->cycles - before;
+    } else if (fast->kind == VERIFY_LOOP) {
+        return loop_run(&fast->packed, cycles, NULL);
+    }
+    return engine_run(&fast->packed, cycles);
+}
+
+// Read the engine's state
+static void fast_state(const FastEngine* fast, VerifyState* state) {
+    memset(state, 0, sizeof(*state));
+    if (fast->kind == VERIFY_SMP) {
+        const SmpMachine* smp = fast->smp;
+        const SmpCpu* cpu = &smp->cpus[0];
+        state->cycles = cpu->cycles;
+        state->beats = cpu->beats;
+        state->accumulator = cpu->accumulator;
+        state->CI = cpu->CI;
+        state->PI = cpu->PI;
+        state->index = cpu->index;
+        state->running = cpu->running;
+        memcpy(state->words, smp->words, smp->memory_size * sizeof(uint32_t));
+    } else {
+        const PackedMachine* machine = &fast->packed;
+        state->cycles = machine->cycles;
+        state->beats = machine->beats;
+        state->accumulator = machine->accumulator;
+        state->CI = machine->CI;
+        state->PI = machine->PI;
+        state->index = machine->index;
+        state->running = machine->running;
+        memcpy(state->words, machine->words, machine->memory_size * sizeof(uint32_t));
+    }
+}
+
+// Pack one reference store word, bit j = store column j
+static uint32_t pack_word(const BabyComputer* computer, int address) {
+    uint32_t word = 0;
+    for (int i = 0; i < WORD_SIZE; i++) {
+        word |= (uint32_t)(computer->store[address][i] & 1) << i;
+    }
+    return word;
+}
+
+// Read the reference state; words is its packed store, kept up to date by the caller
+static void reference_state(const BabyComputer* computer, const uint32_t* words, long long cycles,
+                            VerifyState* state) {
+    memset(state, 0, sizeof(*state));
+    state->cycles = cycles;
+    state->beats = computer->beats;
+    state->accumulator = computer->accumulator;
+    state->CI = computer->CI;
+    state->PI = engine_reverse_bits((uint32_t)computer->PI);
+    state->index = computer->index_reg;
+    state->running = computer->running;
+    memcpy(state->words, words, computer->memory_size * sizeof(uint32_t));
+}
+
+// Whether the instruction at CI ends a block: jumps, CMP's conditional skip,
+// TAS, STP and the CI == 0 skip
+static int ends_block(const BabyComputer* computer) {
+    const int* bits = computer->store[computer->CI];
+    int opcode = bits[13] << 3 | bits[14] << 2 | bits[15] << 1 | bits[16] | bits[17] << 4;
+    return computer->CI == 0 || opcode == JMP || opcode == JRP || opcode == CMP ||
+           opcode == STP || opcode == TAS;
+}
+
+// Replay both machines from the initial image one cycle at a time, comparing
+// the whole state after each, to find the first divergent cycle up to end
+static void locate_divergence(BabyComputer* computer, FastEngine* fast, const PackedMachine* initial,
+                              long long end, VerifyReport* report) {
+    uint32_t words[ENGINE_MAX_WORDS];
+    engine_to_computer(initial, computer);
+    fast_reset(fast, initial);
+    for (long long cycle = 1; cycle <= end; cycle++) {
+        long long step = 0;
+        int ci = computer->CI;
+        uint32_t instruction = pack_word(computer, ci);
+        step_computer(computer, &step);
+        fast_run(fast, 1);
+
+        for (int a = 0; a < computer->memory_size; a++) {
+            words[a] = pack_word(computer, a);
+        }
+        reference_state(computer, words, cycle, &report->reference);
+        fast_state(fast, &report->engine);
+        if (cycle == end || memcmp(&report->reference, &report->engine, sizeof(VerifyState)) != 0) {
+            report->diverged_at = cycle;
+            report->CI = ci;
+            report->instruction = instruction;
+            return;
+        }
+    }
+}
+
+// Run a loaded program on the reference interpreter and a fast engine in lockstep.
+// The states are compared at every block boundary; after a mismatch both are
+// replayed instruction by instruction to find the first divergent cycle.
+// The reference machine is left in its final state. Returns -1 on a divergence.
+int verify_run(BabyComputer* computer, VerifyEngine engine, long long budget, VerifyReport* report) {
+    static SmpMachine smp;
+    static FastEngine fast;
+    PackedMachine initial;
+    uint32_t words[ENGINE_MAX_WORDS];
+    VerifyState expected, actual;
+
+    memset(report, 0, sizeof(*report));
+    report->diverged_at = -1;
+    engine_from_computer(&initial, computer);
+    memcpy(words, initial.words, sizeof(words));
+    fast.kind = engine;
+    fast.smp = &smp;
+    fast_reset(&fast, &initial);
+
+    int trace = computer->trace;
+    unsigned long long dirty = computer->dirty;
+    computer->trace = LOG_OFF;
+    computer->dirty = 0;
+
+    long long cycles = 0;
+    while (computer->running && cycles < budget) {
+        long long start = cycles;
+        int start_CI = computer->CI;
+        uint32_t start_word = words[start_CI];
+        long long step = 0;
+        int end = 0;
+        if (engine == VERIFY_LOOP) {
+            // A summarized loop skips many cycles at once, so the engine leads
+            // and the reference runs the same number of cycles
+            long long limit = start + fast_run(&fast, budget - start < VERIFY_LOOP_CHUNK ?
+                                                      budget - start : VERIFY_LOOP_CHUNK);
+            while (computer->running && cycles < limit) {
+                step_computer(computer, &step);
+                cycles++;
+            }
+        }
+        // Reference: straight-line instructions up to and including the next transfer
+        while (engine != VERIFY_LOOP && !end && computer->running && cycles < budget &&
+               cycles - start < VERIFY_MAX_BLOCK) {
+            end = ends_block(computer);
+            step_computer(computer, &step);
+            cycles++;
+        }
+        while (computer->dirty) {
+            int address = __builtin_ctzll(computer->dirty);
+            computer->dirty &= computer->dirty - 1;
+            words[address] = pack_word(computer, address);
+            dirty |= 1ULL << address;
+        }
+
+        if (engine != VERIFY_LOOP) {
+            fast_run(&fast, cycles - start);
+        }
+        report->blocks++;
+        reference_state(computer, words, cycles, &expected);
+        fast_state(&fast, &actual);
+        if (memcmp(&expected, &actual, sizeof(expected)) != 0) {
+            if (engine == VERIFY_LOOP) {
+                // A summary cannot be replayed a cycle at a time: report the whole chunk
+                report->diverged_at = cycles;
+                report->CI = start_CI;
+                report->instruction = start_word;
+                report->reference = expected;
+                report->engine = actual;
+            } else {
+                locate_divergence(computer, &fast, &initial, cycles, report);
+            }
+            break;
+        }
+    }
+
+    report->cycles = report->diverged_at >= 0 ? report->diverged_at : cycles;
+    computer->trace = trace;
+    computer->dirty |= dirty;
+    return report->diverged_at >= 0 ? -1 : 0;
+}
+
+// Print the outcome of a lockstep run and, after a divergence, every field that differs
+void verify_print(const VerifyReport* report, VerifyEngine engine, int memory_size) {
+    const char* name = verify_engine_name(engine);
+    if (report->diverged_at < 0) {
+        printf("Verified %lld cycles in %lld blocks: %s engine matches the reference\n",
+               report->cycles, report->blocks, name);
+        return;
+    }
+
+    DecodedWord decoded = engine_decode(report->instruction, report->CI, memory_size);
+    if (engine == VERIFY_LOOP) {
+        printf("Divergence from the %s engine by cycle %lld, in the run ahead from CI %d, %s %d (word %d)\n",
+               name, report->diverged_at, report->CI, engine_mnemonic(decoded.opcode),
+               (int)(report->instruction & 0x1FFF), (int32_t)report->instruction);
+    } else {
+        printf("Divergence from the %s engine at cycle %lld: CI %d, %s %d (word %d)\n",
+               name, report->diverged_at, report->CI, engine_mnemonic(decoded.opcode),
+               (int)(report->instruction & 0x1FFF), (int32_t)report->instruction);
+    }
+    const VerifyState* r = &report->reference;
+    const VerifyState* e = &report->engine;
+    if (r->accumulator != e->accumulator) {
+        printf("  A:       reference %d, %s %d\n", r->accumulator, name, e->accumulator);
+    }
+    if (r->CI != e->CI) {
+        printf("  CI:      reference %d, %s %d\n", r->CI, name, e->CI);
+    }
+    if (r->PI != e->PI) {
+        printf("  PI:      reference %d, %s %d\n", (int32_t)r->PI, name, (int32_t)e->PI);
+    }
+    if (r->index != e->index) {
+        printf("  X:       reference %d, %s %d\n", r->index, name, e->index);
+    }
+    if (r->running != e->running) {
+        printf("  running: reference %d, %s %d\n", r->running, name, e->running);
+    }
+    if (r->cycles != e->cycles) {
+        printf("  cycles:  reference %lld, %s %lld\n", r->cycles, name, e->cycles);
+    }
+    if (r->beats != e->beats) {
+        printf("  beats:   reference %lld, %s %lld\n", r->beats, name, e->beats);
+    }
+    for (int a = 0; a < memory_size; a++) {
+        if (r->words[a] != e->words[a]) {
+            printf("  word %2d: reference %d, %s %d\n", a, (int32_t)r->words[a], name, (int32_t)e->words[a]);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdint.h>
+#include "engine.h"
+
+// Longest straight-line run compared as one block
+#define VERIFY_MAX_BLOCK 64
+// Cycles the loop-accelerated engine runs ahead before the reference catches up
+#define VERIFY_LOOP_CHUNK 4096
+
+// Fast engines the verifier can check against fetch/decode/execute
+typedef enum {
+    VERIFY_PACKED = 0,          // engine_run on a PackedMachine
+    VERIFY_SMP = 1,             // One CPU of the SMP core, stepped round-robin
+    VERIFY_LOOP = 2             // loop_run: the packed engine with loop acceleration
+} VerifyEngine;
+
+// Architectural state compared between the reference and an engine
+typedef struct {
+    long long cycles;           // Cycles executed
+    long long beats;            // Simulated machine time in beats
+    int32_t accumulator;        // Accumulator register
+    int32_t CI;                 // Control Instruction (Program Counter)
+    uint32_t PI;                // Last fetched word, in store bit order
+    int32_t index;              // Index register X
+    int32_t running;            // Cleared by STP
+    uint32_t words[ENGINE_MAX_WORDS];  // Store, bit j = store column j
+} VerifyState;
+
+// Outcome of a lockstep run
+typedef struct {
+    long long cycles;           // Cycles run by the reference
+    long long blocks;           // Block boundaries at which the states were compared
+    long long diverged_at;      // First cycle whose state differs, -1 if none
+    int CI;                     // Address of the divergent instruction
+    uint32_t instruction;       // The divergent instruction word
+    VerifyState reference;      // Reference state after the divergent cycle
+    VerifyState engine;         // Engine state after the divergent cycle
+} VerifyReport;
+
+// Function declarations
+int verify_parse_engine(const char* name);
+const char* verify_engine_name(VerifyEngine engine);
+int verify_run(BabyComputer* computer, VerifyEngine engine, long long budget, VerifyReport* report);
+void verify_print(const VerifyReport* report, VerifyEngine engine, int memory_size);
+
+#endif